@@ -0,0 +1,670 @@
+// AABBTree.h
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+#include <Broadphase.h>
+
+// Six planes facing inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// Gribb-Hartmann extraction, viewProjection is projection * view (times model if the boxes are in model space)
+	static Frustum fromMatrix(const glm::mat4& viewProjection) {
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0; // left
+		frustum.planes[1] = row3 - row0; // right
+		frustum.planes[2] = row3 + row1; // bottom
+		frustum.planes[3] = row3 - row1; // top
+		frustum.planes[4] = row3 + row2; // near
+		frustum.planes[5] = row3 - row2; // far
+		for (auto& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	// False only when the box is entirely behind one of the planes
+	bool intersects(glm::vec3 min, glm::vec3 max) const {
+		for (const auto& plane : planes) {
+			// The corner furthest along the plane normal
+			glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+// Slab test, returns the distance along the ray where it enters the box, or a negative value on a miss
+// inverseDirection is 1 / direction, infinite components are fine
+inline float rayIntersectsAABB(glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, glm::vec3 min, glm::vec3 max) {
+	glm::vec3 t1 = (min - origin) * inverseDirection;
+	glm::vec3 t2 = (max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t1, t2);
+	glm::vec3 tFar = glm::max(t1, t2);
+	float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+	return enter <= exit ? enter : -1.0f;
+}
+
+// -------------------------------------------
+// Declaration of DynamicAABBTree class
+// Binary tree of bounding boxes, leaves hold one object each and every inner node bounds its two children
+// Leaves store a fat box grown by a margin around the object, so small moves that stay inside it cost nothing
+// Leaves are inserted next to the sibling that grows the tree's surface area least, and AVL style rotations keep
+// the height close to log N so queries stay O(log N) however unevenly objects are sized or spread
+class DynamicAABBTree {
+public:
+	// Absolute margin added around every fat box, plus a share of the box's own size so big objects get a bigger margin
+	DynamicAABBTree(float margin = 0.1f, float relativeMargin = 0.1f) : margin(margin), relativeMargin(relativeMargin) {}
+
+	uint32_t createProxy(GameObject* owner, glm::vec3 min, glm::vec3 max) {
+		uint32_t id = allocateNode();
+		Node& node = nodes[id];
+		node.owner = owner;
+		node.tightMin = min;
+		node.tightMax = max;
+		fatten(node);
+		node.height = 0;
+		insertLeaf(id);
+		leafCount++;
+		return id;
+	}
+
+	void destroyProxy(uint32_t id) {
+		removeLeaf(id);
+		freeNode(id);
+		leafCount--;
+	}
+
+	// Only reinserts the leaf once the object leaves its fat box, returns true if it did
+	bool updateProxy(uint32_t id, glm::vec3 min, glm::vec3 max) {
+		Node& node = nodes[id];
+		node.tightMin = min;
+		node.tightMax = max;
+		if (contains(node.min, node.max, min, max)) {
+			return false;
+		}
+		removeLeaf(id);
+		fatten(nodes[id]);
+		insertLeaf(id);
+		return true;
+	}
+
+	// Calls visit(owner, proxy) for every object whose AABB overlaps the box
+	template <typename Visit>
+	void queryOverlap(glm::vec3 min, glm::vec3 max, Visit visit) const {
+		if (root == NULL_NODE) {
+			return;
+		}
+		TraversalStack stack;
+		stack.push_back(root);
+		while (!stack.empty()) {
+			uint32_t id = stack.pop_back();
+			const Node& node = nodes[id];
+			if (!overlaps(node.min, node.max, min, max)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				if (overlaps(node.tightMin, node.tightMax, min, max)) {
+					visit(node.owner, id);
+				}
+			}
+			else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+
+	// Calls visit(owner, distance) for every object whose AABB the ray hits within maxDistance
+	// visit returns the new max distance, returning the hit distance finds the closest hit, returning maxDistance finds all of them
+	template <typename Visit>
+	void queryRay(glm::vec3 origin, glm::vec3 direction, float maxDistance, Visit visit) const {
+		querySweep(origin, direction, 0.0f, maxDistance, visit);
+	}
+
+	// queryRay for a sphere of the given radius moving along the ray, every box is grown by the radius
+	template <typename Visit>
+	void querySweep(glm::vec3 origin, glm::vec3 direction, float radius, float maxDistance, Visit visit) const {
+		if (root == NULL_NODE) {
+			return;
+		}
+		glm::vec3 inverseDirection = 1.0f / direction;
+		TraversalStack stack;
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.pop_back()];
+			if (rayIntersectsAABB(origin, inverseDirection, maxDistance, node.min - radius, node.max + radius) < 0.0f) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				float distance = rayIntersectsAABB(origin, inverseDirection, maxDistance, node.tightMin - radius, node.tightMax + radius);
+				if (distance >= 0.0f) {
+					maxDistance = visit(node.owner, distance);
+				}
+			}
+			else {
+				// The nearer child goes on top, so a closest hit search shrinks maxDistance before reaching the farther one
+				const Node& child1 = nodes[node.child1];
+				const Node& child2 = nodes[node.child2];
+				float distance1 = rayIntersectsAABB(origin, inverseDirection, maxDistance, child1.min - radius, child1.max + radius);
+				float distance2 = rayIntersectsAABB(origin, inverseDirection, maxDistance, child2.min - radius, child2.max + radius);
+				bool firstNearer = distance1 <= distance2;
+				if (distance1 >= 0.0f && distance2 >= 0.0f) {
+					stack.push_back(firstNearer ? node.child2 : node.child1);
+					stack.push_back(firstNearer ? node.child1 : node.child2);
+				}
+				else if (distance1 >= 0.0f) {
+					stack.push_back(node.child1);
+				}
+				else if (distance2 >= 0.0f) {
+					stack.push_back(node.child2);
+				}
+			}
+		}
+	}
+
+	// Calls visit(owner) for every object whose AABB is at least partly inside the frustum
+	template <typename Visit>
+	void queryFrustum(const Frustum& frustum, Visit visit) const {
+		if (root == NULL_NODE) {
+			return;
+		}
+		TraversalStack stack;
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.pop_back()];
+			if (!frustum.intersects(node.min, node.max)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				if (frustum.intersects(node.tightMin, node.tightMax)) {
+					visit(node.owner);
+				}
+			}
+			else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+
+	// Calls visit(ownerA, ownerB) once for every pair of objects in this tree whose AABBs overlap
+	// Walks the tree against itself, so whole subtrees that don't touch are skipped in one test
+	template <typename Visit>
+	void queryPairs(Visit visit) const {
+		collideTrees(*this, *this, visit);
+	}
+
+	// Calls visit(owner, otherOwner) for every object here overlapping an object in the other tree
+	template <typename Visit>
+	void queryPairs(const DynamicAABBTree& other, Visit visit) const {
+		collideTrees(*this, other, visit);
+	}
+
+	void getAABB(uint32_t id, glm::vec3& min, glm::vec3& max) const {
+		min = nodes[id].tightMin;
+		max = nodes[id].tightMax;
+	}
+
+	// Longest path from the root to a leaf, a balanced tree sits near log2(size)
+	int getHeight() const {
+		return root == NULL_NODE ? 0 : nodes[root].height;
+	}
+
+	std::size_t size() const {
+		return leafCount;
+	}
+
+	void clear() {
+		nodes.clear();
+		root = NULL_NODE;
+		freeList = NULL_NODE;
+		leafCount = 0;
+	}
+
+private:
+	static const uint32_t NULL_NODE = UINT32_MAX;
+
+	struct Node {
+		glm::vec3 min; // fat box for leaves, union of the children for inner nodes
+		glm::vec3 max;
+		glm::vec3 tightMin; // the object's actual AABB, leaves only
+		glm::vec3 tightMax;
+		GameObject* owner = nullptr;
+		uint32_t parent = NULL_NODE; // next free node while on the free list
+		uint32_t child1 = NULL_NODE;
+		uint32_t child2 = NULL_NODE;
+		int32_t height = -1; // 0 for leaves, -1 for free nodes
+
+		bool isLeaf() const {
+			return child1 == NULL_NODE;
+		}
+	};
+
+	// Depth first traversal stack, only goes to the heap for very deep trees
+	// Local to each query, so queries can run from several threads or inside another query's callback
+	class TraversalStack {
+	public:
+		void push_back(uint32_t id) {
+			if (count < INLINE_SIZE) {
+				local[count] = id;
+			}
+			else {
+				overflow.push_back(id);
+			}
+			count++;
+		}
+
+		uint32_t pop_back() {
+			count--;
+			if (count < INLINE_SIZE) {
+				return local[count];
+			}
+			uint32_t id = overflow.back();
+			overflow.pop_back();
+			return id;
+		}
+
+		bool empty() const {
+			return count == 0;
+		}
+
+	private:
+		static const std::size_t INLINE_SIZE = 64;
+		uint32_t local[INLINE_SIZE];
+		std::vector<uint32_t> overflow;
+		std::size_t count = 0;
+	};
+
+	std::vector<Node> nodes;
+	uint32_t root = NULL_NODE;
+	uint32_t freeList = NULL_NODE;
+	std::size_t leafCount = 0;
+	float margin;
+	float relativeMargin;
+
+	static bool overlaps(glm::vec3 minA, glm::vec3 maxA, glm::vec3 minB, glm::vec3 maxB) {
+		return minA.x <= maxB.x && maxA.x >= minB.x &&
+			minA.y <= maxB.y && maxA.y >= minB.y &&
+			minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	static bool contains(glm::vec3 outerMin, glm::vec3 outerMax, glm::vec3 innerMin, glm::vec3 innerMax) {
+		return glm::all(glm::lessThanEqual(outerMin, innerMin)) && glm::all(glm::greaterThanEqual(outerMax, innerMax));
+	}
+
+	static float surfaceArea(glm::vec3 min, glm::vec3 max) {
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// Pairs of subtrees still to test, a node paired with itself stands for every pair inside that subtree
+	template <typename Visit>
+	static void collideTrees(const DynamicAABBTree& treeA, const DynamicAABBTree& treeB, Visit visit) {
+		if (treeA.root == NULL_NODE || treeB.root == NULL_NODE) {
+			return;
+		}
+		bool self = &treeA == &treeB;
+		std::vector<std::pair<uint32_t, uint32_t>> stack;
+		stack.emplace_back(treeA.root, treeB.root);
+		while (!stack.empty()) {
+			auto [a, b] = stack.back();
+			stack.pop_back();
+			const Node& nodeA = treeA.nodes[a];
+			const Node& nodeB = treeB.nodes[b];
+			if (self && a == b) {
+				if (!nodeA.isLeaf()) {
+					stack.emplace_back(nodeA.child1, nodeA.child1);
+					stack.emplace_back(nodeA.child2, nodeA.child2);
+					stack.emplace_back(nodeA.child1, nodeA.child2);
+				}
+				continue;
+			}
+			if (!overlaps(nodeA.min, nodeA.max, nodeB.min, nodeB.max)) {
+				continue;
+			}
+			if (nodeA.isLeaf() && nodeB.isLeaf()) {
+				if (overlaps(nodeA.tightMin, nodeA.tightMax, nodeB.tightMin, nodeB.tightMax)) {
+					visit(nodeA.owner, nodeB.owner);
+				}
+			}
+			// Descend into the bigger of the two, so both sides shrink at a similar rate
+			else if (nodeB.isLeaf() || (!nodeA.isLeaf() && surfaceArea(nodeA.min, nodeA.max) >= surfaceArea(nodeB.min, nodeB.max))) {
+				stack.emplace_back(nodeA.child1, b);
+				stack.emplace_back(nodeA.child2, b);
+			}
+			else {
+				stack.emplace_back(a, nodeB.child1);
+				stack.emplace_back(a, nodeB.child2);
+			}
+		}
+	}
+
+	void fatten(Node& node) const {
+		glm::vec3 grow = glm::vec3(margin) + (node.tightMax - node.tightMin) * relativeMargin;
+		node.min = node.tightMin - grow;
+		node.max = node.tightMax + grow;
+	}
+
+	uint32_t allocateNode() {
+		uint32_t id;
+		if (freeList != NULL_NODE) {
+			id = freeList;
+			freeList = nodes[id].parent;
+			nodes[id] = Node();
+		}
+		else {
+			id = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+		}
+		return id;
+	}
+
+	void freeNode(uint32_t id) {
+		nodes[id].parent = freeList;
+		nodes[id].owner = nullptr;
+		nodes[id].height = -1;
+		freeList = id;
+	}
+
+	void refitNode(uint32_t id) {
+		Node& node = nodes[id];
+		const Node& child1 = nodes[node.child1];
+		const Node& child2 = nodes[node.child2];
+		node.min = glm::min(child1.min, child2.min);
+		node.max = glm::max(child1.max, child2.max);
+		node.height = 1 + std::max(child1.height, child2.height);
+	}
+
+	void insertLeaf(uint32_t leaf) {
+		if (root == NULL_NODE) {
+			root = leaf;
+			nodes[leaf].parent = NULL_NODE;
+			return;
+		}
+
+		// Walk down towards the cheapest sibling, where cost is the surface area added to the tree
+		glm::vec3 leafMin = nodes[leaf].min;
+		glm::vec3 leafMax = nodes[leaf].max;
+		uint32_t index = root;
+		while (!nodes[index].isLeaf()) {
+			const Node& node = nodes[index];
+			float area = surfaceArea(node.min, node.max);
+			float combinedArea = surfaceArea(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+			// Pairing with this node makes a new parent, going further down also grows this node
+			float cost = 2.0f * combinedArea;
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto descendCost = [&](uint32_t child) {
+				const Node& childNode = nodes[child];
+				float grownArea = surfaceArea(glm::min(childNode.min, leafMin), glm::max(childNode.max, leafMax));
+				if (childNode.isLeaf()) {
+					return grownArea + inheritanceCost;
+				}
+				return grownArea - surfaceArea(childNode.min, childNode.max) + inheritanceCost;
+			};
+			float cost1 = descendCost(node.child1);
+			float cost2 = descendCost(node.child2);
+
+			if (cost < cost1 && cost < cost2) {
+				break;
+			}
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		uint32_t sibling = index;
+		uint32_t oldParent = nodes[sibling].parent;
+		uint32_t newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+		refitNode(newParent);
+
+		if (oldParent == NULL_NODE) {
+			root = newParent;
+		}
+		else if (nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		}
+		else {
+			nodes[oldParent].child2 = newParent;
+		}
+
+		refitAncestors(nodes[leaf].parent);
+	}
+
+	void removeLeaf(uint32_t leaf) {
+		if (leaf == root) {
+			root = NULL_NODE;
+			return;
+		}
+
+		// The parent goes away and the sibling takes its place
+		uint32_t parent = nodes[leaf].parent;
+		uint32_t grandParent = nodes[parent].parent;
+		uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+		if (grandParent == NULL_NODE) {
+			root = sibling;
+			nodes[sibling].parent = NULL_NODE;
+			freeNode(parent);
+			return;
+		}
+		if (nodes[grandParent].child1 == parent) {
+			nodes[grandParent].child1 = sibling;
+		}
+		else {
+			nodes[grandParent].child2 = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refitAncestors(grandParent);
+	}
+
+	// Refits every node from index up to the root, rotating any that became unbalanced on the way
+	void refitAncestors(uint32_t index) {
+		while (index != NULL_NODE) {
+			index = balance(index);
+			refitNode(index);
+			index = nodes[index].parent;
+		}
+	}
+
+	// If one child of a is two or more levels taller than the other, the taller child is rotated up into a's place
+	// Returns the node now sitting where a was
+	uint32_t balance(uint32_t a) {
+		Node& nodeA = nodes[a];
+		if (nodeA.isLeaf() || nodeA.height < 2) {
+			return a;
+		}
+		uint32_t b = nodeA.child1;
+		uint32_t c = nodeA.child2;
+		int32_t difference = nodes[c].height - nodes[b].height;
+		if (difference > 1) {
+			return rotateUp(a, c);
+		}
+		if (difference < -1) {
+			return rotateUp(a, b);
+		}
+		return a;
+	}
+
+	// Lifts the tall child above a, a keeps the other child plus the shorter grandchild
+	uint32_t rotateUp(uint32_t a, uint32_t tall) {
+		Node& nodeA = nodes[a];
+		Node& nodeTall = nodes[tall];
+		uint32_t f = nodeTall.child1;
+		uint32_t g = nodeTall.child2;
+
+		nodeTall.child1 = a;
+		nodeTall.parent = nodeA.parent;
+		nodeA.parent = tall;
+
+		if (nodeTall.parent == NULL_NODE) {
+			root = tall;
+		}
+		else if (nodes[nodeTall.parent].child1 == a) {
+			nodes[nodeTall.parent].child1 = tall;
+		}
+		else {
+			nodes[nodeTall.parent].child2 = tall;
+		}
+
+		// The taller grandchild stays under the lifted node, the shorter one moves across to a
+		uint32_t keep = nodes[f].height > nodes[g].height ? f : g;
+		uint32_t give = keep == f ? g : f;
+		nodeTall.child2 = keep;
+		if (nodeA.child1 == tall) {
+			nodeA.child1 = give;
+		}
+		else {
+			nodeA.child2 = give;
+		}
+		nodes[give].parent = a;
+
+		refitNode(a);
+		refitNode(tall);
+		return tall;
+	}
+};
+
+// -------------------------------------------
+// Declaration of AABBTreeBroadphase class
+// Two DynamicAABBTrees behind the same interface as the other broadphases
+// Static objects live in their own tree so the dynamic tree stays small, and static geometry is never refit
+// unless it is actually moved; pairs are only searched for from dynamic objects
+class AABBTreeBroadphase {
+public:
+	uint32_t createProxy(GameObject* owner, glm::vec3 min, glm::vec3 max, bool isStatic = false) {
+		if (isStatic) {
+			return staticTree.createProxy(owner, min, max) | STATIC_FLAG;
+		}
+		return dynamicTree.createProxy(owner, min, max);
+	}
+
+	void destroyProxy(uint32_t id) {
+		if (id & STATIC_FLAG) {
+			staticTree.destroyProxy(id & ~STATIC_FLAG);
+		}
+		else {
+			dynamicTree.destroyProxy(id);
+		}
+	}
+
+	void updateProxy(uint32_t id, glm::vec3 min, glm::vec3 max) {
+		if (id & STATIC_FLAG) {
+			staticTree.updateProxy(id & ~STATIC_FLAG, min, max);
+		}
+		else {
+			dynamicTree.updateProxy(id, min, max);
+		}
+	}
+
+	// Every overlapping pair with at least one dynamic object, from the dynamic tree against itself and the static tree
+	const std::vector<CollisionPair>& update() {
+		pairs.clear();
+		auto collect = [&](GameObject* a, GameObject* b) {
+			pairs.emplace_back(a, b);
+		};
+		dynamicTree.queryPairs(collect);
+		dynamicTree.queryPairs(staticTree, collect);
+		return pairs;
+	}
+
+	const std::vector<CollisionPair>& getPairs() const {
+		return pairs;
+	}
+
+	void queryRegion(glm::vec3 min, glm::vec3 max, std::vector<GameObject*>& results) const {
+		auto collect = [&](GameObject* object, uint32_t) {
+			results.push_back(object);
+		};
+		dynamicTree.queryOverlap(min, max, collect);
+		staticTree.queryOverlap(min, max, collect);
+	}
+
+	void queryRadius(glm::vec3 centre, float radius, std::vector<GameObject*>& results) const {
+		float radiusSquared = radius * radius;
+		auto collect = [&](GameObject* object, uint32_t id, const DynamicAABBTree& tree) {
+			glm::vec3 min, max;
+			tree.getAABB(id, min, max);
+			glm::vec3 offset = glm::clamp(centre, min, max) - centre;
+			if (glm::dot(offset, offset) <= radiusSquared) {
+				results.push_back(object);
+			}
+		};
+		dynamicTree.queryOverlap(centre - radius, centre + radius, [&](GameObject* object, uint32_t id) {
+			collect(object, id, dynamicTree);
+		});
+		staticTree.queryOverlap(centre - radius, centre + radius, [&](GameObject* object, uint32_t id) {
+			collect(object, id, staticTree);
+		});
+	}
+
+	template <typename Visit>
+	void queryRay(glm::vec3 origin, glm::vec3 direction, float maxDistance, Visit visit) const {
+		querySweep(origin, direction, 0.0f, maxDistance, visit);
+	}
+
+	template <typename Visit>
+	void querySweep(glm::vec3 origin, glm::vec3 direction, float radius, float maxDistance, Visit visit) const {
+		// The static tree is walked with whatever distance the dynamic tree left, so closest hit searches carry over
+		dynamicTree.querySweep(origin, direction, radius, maxDistance, [&](GameObject* object, float distance) {
+			maxDistance = visit(object, distance);
+			return maxDistance;
+		});
+		staticTree.querySweep(origin, direction, radius, maxDistance, visit);
+	}
+
+	template <typename Visit>
+	void queryFrustum(const Frustum& frustum, Visit visit) const {
+		dynamicTree.queryFrustum(frustum, visit);
+		staticTree.queryFrustum(frustum, visit);
+	}
+
+	const DynamicAABBTree& getDynamicTree() const {
+		return dynamicTree;
+	}
+
+	const DynamicAABBTree& getStaticTree() const {
+		return staticTree;
+	}
+
+	std::size_t size() const {
+		return dynamicTree.size() + staticTree.size();
+	}
+
+	void clear() {
+		dynamicTree.clear();
+		staticTree.clear();
+		pairs.clear();
+	}
+
+private:
+	static const uint32_t STATIC_FLAG = 0x80000000u;
+
+	DynamicAABBTree dynamicTree;
+	DynamicAABBTree staticTree;
+	std::vector<CollisionPair> pairs;
+};
+
+#endif // AABBTREE_H
@@ -0,0 +1,187 @@
+// Allocators.h
+#ifndef ALLOCATORS_H
+#define ALLOCATORS_H
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+// Numbers reported by the allocators below, for watching memory use while the scene runs
+struct AllocatorStats {
+	std::size_t liveAllocations = 0; // objects or blocks currently handed out
+	std::size_t bytesInUse = 0;
+	std::size_t bytesReserved = 0; // everything taken from the system, including unused space
+	float fragmentation = 0.0f; // share of reserved bytes that aren't in use, 0 to 1
+};
+
+// -------------------------------------------
+// Declaration of ObjectPool class
+// Fixed size slots carved out of large slabs, freed slots are kept on a free list and reused
+// Spawning and destroying objects never goes to malloc once the slabs exist
+template <typename T, std::size_t SlotsPerSlab = 1024>
+class ObjectPool {
+public:
+	ObjectPool() = default;
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	~ObjectPool() {
+		for (auto slab : slabs) {
+			::operator delete(slab);
+		}
+	}
+
+	void* allocate() {
+		if (!freeList) {
+			addSlab();
+		}
+		FreeSlot* slot = freeList;
+		freeList = slot->next;
+		live++;
+		return slot;
+	}
+
+	void deallocate(void* pointer) {
+		FreeSlot* slot = static_cast<FreeSlot*>(pointer);
+		slot->next = freeList;
+		freeList = slot;
+		live--;
+	}
+
+	// Gives every slab back to the system, only allowed once nothing is live (e.g. after a scene is cleared)
+	bool releaseAll() {
+		if (live != 0) {
+			return false;
+		}
+		for (auto slab : slabs) {
+			::operator delete(slab);
+		}
+		slabs.clear();
+		freeList = nullptr;
+		return true;
+	}
+
+	AllocatorStats getStats() const {
+		AllocatorStats stats;
+		stats.liveAllocations = live;
+		stats.bytesInUse = live * slotSize();
+		stats.bytesReserved = slabs.size() * SlotsPerSlab * slotSize();
+		if (stats.bytesReserved > 0) {
+			stats.fragmentation = 1.0f - static_cast<float>(stats.bytesInUse) / static_cast<float>(stats.bytesReserved);
+		}
+		return stats;
+	}
+
+private:
+	struct FreeSlot {
+		FreeSlot* next;
+	};
+
+	// Functions rather than constants, so the pool can be declared before T is complete
+	static constexpr std::size_t slotAlign() {
+		return alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+	}
+
+	static constexpr std::size_t slotSize() {
+		return ((std::max(sizeof(T), sizeof(FreeSlot)) + slotAlign() - 1) / slotAlign()) * slotAlign();
+	}
+
+	std::vector<void*> slabs;
+	FreeSlot* freeList = nullptr;
+	std::size_t live = 0;
+
+	// Threads the new slab's slots onto the free list in address order, so consecutive spawns sit next to each other
+	void addSlab() {
+		static_assert(slotAlign() <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "ObjectPool slabs only have the default new alignment");
+		char* slab = static_cast<char*>(::operator new(SlotsPerSlab * slotSize()));
+		slabs.push_back(slab);
+		for (std::size_t i = SlotsPerSlab; i-- > 0;) {
+			FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + i * slotSize());
+			slot->next = freeList;
+			freeList = slot;
+		}
+	}
+};
+
+// -------------------------------------------
+// Declaration of ChunkedArena class
+// Bump allocator over large chunks, individual allocations are never freed
+// Everything is released at once with reset(), which is how a scene's mesh data is thrown away
+class ChunkedArena {
+public:
+	ChunkedArena(std::size_t chunkBytes = 1 << 20) : chunkSize(chunkBytes) {}
+	ChunkedArena(const ChunkedArena&) = delete;
+	ChunkedArena& operator=(const ChunkedArena&) = delete;
+
+	~ChunkedArena() {
+		reset();
+	}
+
+	void* allocate(std::size_t size, std::size_t alignment = 32) {
+		std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+		if (chunks.empty() || offset + size > chunks.back().size) {
+			// Oversized requests get a chunk of their own
+			addChunk(std::max(chunkSize, size + alignment));
+			offset = 0;
+		}
+		Chunk& chunk = chunks.back();
+		void* pointer = chunk.data + offset;
+		used = offset + size;
+		live++;
+		bytesInUse += size;
+		return pointer;
+	}
+
+	// Copies count elements into the arena and returns the copy
+	template <typename T>
+	T* copy(const T* source, std::size_t count) {
+		T* destination = static_cast<T*>(allocate(count * sizeof(T), std::max<std::size_t>(alignof(T), 32)));
+		std::copy(source, source + count, destination);
+		return destination;
+	}
+
+	void reset() {
+		for (auto& chunk : chunks) {
+			::operator delete(chunk.data, std::align_val_t(32));
+		}
+		chunks.clear();
+		used = 0;
+		live = 0;
+		bytesInUse = 0;
+	}
+
+	AllocatorStats getStats() const {
+		AllocatorStats stats;
+		stats.liveAllocations = live;
+		stats.bytesInUse = bytesInUse;
+		for (const auto& chunk : chunks) {
+			stats.bytesReserved += chunk.size;
+		}
+		if (stats.bytesReserved > 0) {
+			stats.fragmentation = 1.0f - static_cast<float>(stats.bytesInUse) / static_cast<float>(stats.bytesReserved);
+		}
+		return stats;
+	}
+
+private:
+	struct Chunk {
+		char* data;
+		std::size_t size;
+	};
+
+	std::vector<Chunk> chunks;
+	std::size_t chunkSize;
+	std::size_t used = 0; // bytes used in the newest chunk
+	std::size_t live = 0;
+	std::size_t bytesInUse = 0;
+
+	void addChunk(std::size_t size) {
+		char* data = static_cast<char*>(::operator new(size, std::align_val_t(32)));
+		chunks.push_back({ data, size });
+		used = 0;
+	}
+};
+
+#endif // ALLOCATORS_H
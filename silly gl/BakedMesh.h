@@ -0,0 +1,192 @@
+// BakedMesh.h
+#ifndef BAKEDMESH_H
+#define BAKEDMESH_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <fstream>
+#include <bit>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <Meshes.h>
+#include <MappedFile.h>
+
+// A mesh exactly as the registry holds it once registered, written out so a later run can map it back in instead of
+// importing and optimizing it again
+// The file is a BakedMeshHeader followed by the vertex positions and each level of detail's 32 bit indices, every blob
+// starting on a BAKED_MESH_ALIGNMENT boundary, all little endian
+// Each position is three floats padded with zeros to vertexStride bytes, which is sizeof(glm::vec3) in the baking build
+// (16 with GLM_FORCE_ALIGNED), so the loader can use them in place and only accepts files with its own stride
+const uint32_t BAKED_MESH_MAGIC = 0x48534D53; // "SMSH"
+const uint32_t BAKED_MESH_VERSION = 2; // bump when the layout or MeshRegistry's hash changes
+const std::size_t BAKED_MESH_ALIGNMENT = 64;
+const uint32_t BAKED_MESH_BOX = 1; // flag, see Mesh::box
+
+struct BakedMeshLod {
+	uint64_t indexOffset;
+	uint32_t indexCount;
+	float error;
+};
+
+struct BakedMeshHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t flags;
+	uint64_t fileSize;
+	uint64_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t lodCount;
+	uint32_t vertexStride; // bytes from one position to the next
+	uint32_t reserved; // zero, keeps hash aligned without padding the compiler might leave uninitialised
+	float boundsMin[3];
+	float boundsMax[3];
+	uint64_t hash;
+	BakedMeshLod lods[MAX_MESH_LODS];
+};
+
+static_assert(std::is_trivially_copyable_v<BakedMeshHeader>, "the header is written and read as raw bytes");
+
+// Writes a registered mesh, levels of detail included, false with error set if the file can't be written
+inline bool writeBakedMesh(const Mesh& mesh, const std::string& path, std::string* error = nullptr) {
+	if constexpr (std::endian::native != std::endian::little) {
+		if (error) {
+			*error = "baked meshes can only be written on little endian machines";
+		}
+		return false;
+	}
+	auto align = [](uint64_t offset) {
+		return (offset + BAKED_MESH_ALIGNMENT - 1) / BAKED_MESH_ALIGNMENT * BAKED_MESH_ALIGNMENT;
+	};
+
+	BakedMeshHeader header = {};
+	header.magic = BAKED_MESH_MAGIC;
+	header.version = BAKED_MESH_VERSION;
+	header.headerSize = sizeof(BakedMeshHeader);
+	header.flags = mesh.box ? BAKED_MESH_BOX : 0;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.lodCount = mesh.lodCount;
+	header.vertexStride = sizeof(glm::vec3);
+	std::memcpy(header.boundsMin, &mesh.boundsMin, sizeof(header.boundsMin));
+	std::memcpy(header.boundsMax, &mesh.boundsMax, sizeof(header.boundsMax));
+	header.hash = mesh.hash;
+	uint64_t offset = align(sizeof(BakedMeshHeader));
+	header.vertexOffset = offset;
+	offset = align(offset + static_cast<uint64_t>(mesh.vertices.size()) * header.vertexStride);
+	for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+		header.lods[lod] = { offset, static_cast<uint32_t>(mesh.lods[lod].indices.size()), mesh.lods[lod].error };
+		offset = align(offset + mesh.lods[lod].indices.size_bytes());
+	}
+	header.fileSize = offset;
+
+	// Only the three floats of each position are copied, so any padding glm::vec3 has is written as zeros and the same
+	// mesh always bakes to the same bytes
+	std::vector<uint8_t> vertices(mesh.vertices.size() * header.vertexStride, 0);
+	for (std::size_t i = 0; i < mesh.vertices.size(); ++i) {
+		float position[3] = { mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z };
+		std::memcpy(vertices.data() + i * header.vertexStride, position, sizeof(position));
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	std::size_t written = 0;
+	auto write = [&](uint64_t at, const void* data, std::size_t size) {
+		static const char padding[BAKED_MESH_ALIGNMENT] = {};
+		file.write(padding, static_cast<std::streamsize>(at - written));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		written = at + size;
+	};
+	write(0, &header, sizeof(header));
+	write(header.vertexOffset, vertices.data(), vertices.size());
+	for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+		write(header.lods[lod].indexOffset, mesh.lods[lod].indices.data(), mesh.lods[lod].indices.size_bytes());
+	}
+	write(header.fileSize, nullptr, 0);
+	file.close();
+	if (!file) {
+		if (error) {
+			*error = "can't write " + path;
+		}
+		return false;
+	}
+	return true;
+}
+
+// Maps a baked mesh file and registers it in meshRegistry pointing straight into the mapping, see
+// MeshRegistry::addBakedMesh, the only pass over the data is a check that every index is in range
+// NO_MESH comes back, with error set, if the file can't be read or isn't a baked mesh of this version
+inline MeshHandle loadBakedMesh(const std::string& path, std::string* error = nullptr) {
+	auto fail = [&](const std::string& reason) {
+		if (error) {
+			*error = path + ": " + reason;
+		}
+		return NO_MESH;
+	};
+	if constexpr (std::endian::native != std::endian::little) {
+		return fail("baked meshes can only be read on little endian machines");
+	}
+	auto file = std::make_shared<MappedFile>();
+	if (!file->open(path)) {
+		return fail("can't open the file");
+	}
+	BakedMeshHeader header;
+	if (file->size() < sizeof(header)) {
+		return fail("not a baked mesh");
+	}
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (header.magic != BAKED_MESH_MAGIC) {
+		return fail("not a baked mesh");
+	}
+	if (header.version != BAKED_MESH_VERSION || header.headerSize != sizeof(header)) {
+		return fail("baked with version " + std::to_string(header.version) + ", this build reads version " + std::to_string(BAKED_MESH_VERSION));
+	}
+	if (header.vertexStride != sizeof(glm::vec3)) {
+		return fail("baked with " + std::to_string(header.vertexStride) + " byte positions, this build uses " + std::to_string(sizeof(glm::vec3)));
+	}
+	if (header.fileSize != file->size() || header.lodCount == 0 || header.lodCount > MAX_MESH_LODS) {
+		return fail("header doesn't match the file");
+	}
+	// Offsets are checked against the size first, so nothing below can read outside the mapping
+	auto inFile = [&](uint64_t offset, uint64_t count, uint64_t elementSize) {
+		return offset % BAKED_MESH_ALIGNMENT == 0 && offset <= file->size() && count <= (file->size() - offset) / elementSize;
+	};
+	if (!inFile(header.vertexOffset, header.vertexCount, sizeof(glm::vec3))) {
+		return fail("vertices are misaligned or run past the end of the file");
+	}
+
+	Mesh mesh;
+	mesh.vertices = std::span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(file->data() + header.vertexOffset), header.vertexCount);
+	std::memcpy(&mesh.boundsMin, header.boundsMin, sizeof(header.boundsMin));
+	std::memcpy(&mesh.boundsMax, header.boundsMax, sizeof(header.boundsMax));
+	mesh.hash = header.hash;
+	mesh.box = (header.flags & BAKED_MESH_BOX) != 0;
+	mesh.lodCount = header.lodCount;
+	for (uint32_t lod = 0; lod < header.lodCount; ++lod) {
+		const BakedMeshLod& baked = header.lods[lod];
+		if (!inFile(baked.indexOffset, baked.indexCount, sizeof(unsigned int))) {
+			return fail("level " + std::to_string(lod) + " is misaligned or runs past the end of the file");
+		}
+		std::span<const unsigned int> indices(reinterpret_cast<const unsigned int*>(file->data() + baked.indexOffset), baked.indexCount);
+		// Everything else indexes vertices without checking, so a bad index has to be caught here
+		for (unsigned int index : indices) {
+			if (index >= header.vertexCount) {
+				return fail("level " + std::to_string(lod) + " has an index past the last vertex");
+			}
+		}
+		mesh.lods[lod] = { indices, baked.error };
+	}
+	for (uint32_t lod = header.lodCount; lod < MAX_MESH_LODS; ++lod) {
+		mesh.lods[lod] = { std::span<const unsigned int>(), 0.0f };
+	}
+	mesh.indices = mesh.lods[0].indices;
+	return meshRegistry.addBakedMesh(mesh, file);
+}
+
+#endif
@@ -0,0 +1,499 @@
+// Broadphase.h
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+class GameObject;
+
+// Two objects whose AABBs overlap
+typedef std::pair<GameObject*, GameObject*> CollisionPair;
+
+const uint32_t NO_PROXY = UINT32_MAX;
+
+// -------------------------------------------
+// Declaration of SweepAndPrune class
+// Incremental sweep and prune: the min and max of every box are kept as sorted endpoint lists on all three axes,
+// and the overlapping pair set is kept between updates
+// When a box moves, its endpoints are insertion sorted into place, and every endpoint they pass is a pair starting
+// or stopping to overlap, so a frame with small motion costs O(N + swaps) rather than a full sweep
+// Endpoint values and list positions are kept per axis in flat arrays indexed by endpoint (see endpointIndex) rather
+// than in the proxies, so the lookups made for every edge and every swap stay within a few hundred KB
+class SweepAndPrune {
+public:
+	uint32_t createProxy(GameObject* owner, glm::vec3 min, glm::vec3 max) {
+		uint32_t id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else {
+			id = static_cast<uint32_t>(proxies.size());
+			proxies.emplace_back();
+			for (int axis = 0; axis < 3; ++axis) {
+				bounds[axis].resize(proxies.size() * 2);
+				positions[axis].resize(proxies.size() * 2);
+			}
+		}
+		Proxy& proxy = proxies[id];
+		proxy.owner = owner;
+		setBounds(id, min, max);
+		proxy.inserted = false;
+		proxy.moved = false;
+		pending.push_back(id);
+		return id;
+	}
+
+	// The proxy is only flagged here, the next update removes every flagged proxy in one pass
+	void destroyProxy(uint32_t id) {
+		Proxy& proxy = proxies[id];
+		proxy.owner = nullptr;
+		if (proxy.inserted) {
+			removedCount++;
+		}
+		else {
+			pending.erase(std::find(pending.begin(), pending.end(), id));
+			freeIds.push_back(id);
+		}
+	}
+
+	// Bounds that didn't change cost nothing at the next update
+	void updateProxy(uint32_t id, glm::vec3 min, glm::vec3 max) {
+		Proxy& proxy = proxies[id];
+		if (!setBounds(id, min, max)) {
+			return;
+		}
+		if (proxy.inserted && !proxy.moved) {
+			proxy.moved = true;
+			moved.push_back(id);
+		}
+	}
+
+	// Brings the endpoint lists up to date and returns every overlapping pair
+	const std::vector<CollisionPair>& update() {
+		if (removedCount > 0) {
+			removeDeadProxies();
+		}
+
+		// Bubbling proxies one at a time jumps all over the edge lists, once a good share of the scene has moved
+		// it is faster to refresh every endpoint and insertion sort each whole list front to back
+		if (moved.size() > insertedCount / 8) {
+			for (int axis = 0; axis < 3; ++axis) {
+				sortAxis(axis);
+			}
+			for (uint32_t id : moved) {
+				proxies[id].moved = false;
+			}
+		}
+		else {
+			for (uint32_t id : moved) {
+				Proxy& proxy = proxies[id];
+				proxy.moved = false;
+				if (proxy.owner) {
+					moveProxy(id);
+				}
+			}
+		}
+		moved.clear();
+
+		if (!pending.empty()) {
+			insertPending();
+		}
+		return pairs;
+	}
+
+	const std::vector<CollisionPair>& getPairs() const {
+		return pairs;
+	}
+
+	std::size_t size() const {
+		return insertedCount + pending.size();
+	}
+
+	void clear() {
+		for (int axis = 0; axis < 3; ++axis) {
+			edges[axis].clear();
+			bounds[axis].clear();
+			positions[axis].clear();
+		}
+		proxies.clear();
+		freeIds.clear();
+		pending.clear();
+		moved.clear();
+		insertedCount = 0;
+		removedCount = 0;
+		pairs.clear();
+		pairKeys.clear();
+		pairLookup.clear();
+	}
+
+private:
+	static const uint32_t MAX_FLAG = 0x80000000u;
+
+	// Edge order on every list: by value, with mins before maxes on ties, so touching boxes count as overlapping
+	// like checkCollision, and then by proxy id. Every sort uses it, otherwise the order of equal endpoints would
+	// depend on history
+	// The value's sortable bits sit above the proxy id and MAX_FLAG, so that order is a single integer compare,
+	// which keeps the insertion sorts' inner loops short
+	struct Edge {
+		uint64_t key;
+
+		Edge(uint32_t value, uint32_t proxy) : key(static_cast<uint64_t>(value) << 32 | proxy) {}
+
+		uint32_t value() const {
+			return static_cast<uint32_t>(key >> 32);
+		}
+
+		// Proxy id, with MAX_FLAG set for a max endpoint
+		uint32_t proxy() const {
+			return static_cast<uint32_t>(key);
+		}
+	};
+
+	static bool edgeLess(const Edge& a, const Edge& b) {
+		return a.key < b.key;
+	}
+
+	// Maps a float to bits that sort the same way as unsigned integers, with -0 and +0 equal as in float compares
+	static uint32_t sortableBits(float value) {
+		value += 0.0f;
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	struct Proxy {
+		GameObject* owner = nullptr;
+		bool inserted = false;
+		bool moved = false;
+		bool isNew = false; // only set while insertPending runs
+	};
+
+	std::vector<Edge> edges[3];
+	std::vector<uint32_t> bounds[3]; // each endpoint's value as sortableBits, by endpointIndex
+	std::vector<uint32_t> positions[3]; // each endpoint's position in edges, by endpointIndex
+	std::vector<Proxy> proxies;
+	std::vector<uint32_t> freeIds;
+	std::vector<uint32_t> pending; // created but not yet in the edge lists
+	std::vector<uint32_t> moved;
+	std::size_t insertedCount = 0;
+	std::size_t removedCount = 0;
+
+	std::vector<CollisionPair> pairs;
+	std::vector<uint64_t> pairKeys; // pairKeys[i] identifies pairs[i]
+	std::unordered_map<uint64_t, uint32_t> pairLookup; // key to position in pairs
+
+	// A proxy's min is at 2 * id and its max straight after it
+	static uint32_t endpointIndex(uint32_t edgeProxy) {
+		return ((edgeProxy & ~MAX_FLAG) << 1) | (edgeProxy >> 31);
+	}
+
+	uint32_t minValue(int axis, uint32_t id) const {
+		return bounds[axis][id * 2];
+	}
+
+	uint32_t maxValue(int axis, uint32_t id) const {
+		return bounds[axis][id * 2 + 1];
+	}
+
+	uint32_t minPosition(int axis, uint32_t id) const {
+		return positions[axis][id * 2];
+	}
+
+	uint32_t maxPosition(int axis, uint32_t id) const {
+		return positions[axis][id * 2 + 1];
+	}
+
+	// False if the bounds are the ones already stored
+	bool setBounds(uint32_t id, glm::vec3 min, glm::vec3 max) {
+		bool changed = false;
+		for (int axis = 0; axis < 3; ++axis) {
+			uint32_t* values = &bounds[axis][id * 2];
+			uint32_t newMin = sortableBits(min[axis]);
+			uint32_t newMax = sortableBits(max[axis]);
+			changed |= values[0] != newMin || values[1] != newMax;
+			values[0] = newMin;
+			values[1] = newMax;
+		}
+		return changed;
+	}
+
+	static uint64_t pairKey(uint32_t a, uint32_t b) {
+		if (a > b) {
+			std::swap(a, b);
+		}
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	void addPair(uint32_t a, uint32_t b) {
+		uint64_t key = pairKey(a, b);
+		if (pairLookup.emplace(key, static_cast<uint32_t>(pairs.size())).second) {
+			pairs.emplace_back(proxies[a].owner, proxies[b].owner);
+			pairKeys.push_back(key);
+		}
+	}
+
+	void removePair(uint32_t a, uint32_t b) {
+		auto it = pairLookup.find(pairKey(a, b));
+		if (it == pairLookup.end()) {
+			return;
+		}
+		uint32_t index = it->second;
+		pairLookup.erase(it);
+		pairs[index] = pairs.back();
+		pairKeys[index] = pairKeys.back();
+		pairs.pop_back();
+		pairKeys.pop_back();
+		if (index < pairs.size()) {
+			pairLookup[pairKeys[index]] = index;
+		}
+	}
+
+	// Overlap test on the two axes other than skipAxis, using endpoint positions
+	// A pair can only be in the set while these overlap, so crossings that fail this need no pair lookup at all
+	bool overlapsOtherAxes(uint32_t a, uint32_t b, int skipAxis) const {
+		for (int axis = 0; axis < 3; ++axis) {
+			if (axis != skipAxis && (maxPosition(axis, a) < minPosition(axis, b) || maxPosition(axis, b) < minPosition(axis, a))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void setEdgePosition(int axis, uint32_t position) {
+		positions[axis][endpointIndex(edges[axis][position].proxy())] = position;
+	}
+
+	// Moves the edge at position down until it is sorted, reporting pairs whose endpoints it crosses
+	void sortDown(int axis, uint32_t position) {
+		std::vector<Edge>& list = edges[axis];
+		Edge edge = list[position];
+		uint32_t self = edge.proxy() & ~MAX_FLAG;
+		bool isMax = (edge.proxy() & MAX_FLAG) != 0;
+		while (position > 0 && edgeLess(edge, list[position - 1])) {
+			const Edge& other = list[position - 1];
+			uint32_t otherId = other.proxy() & ~MAX_FLAG;
+			bool otherIsMax = (other.proxy() & MAX_FLAG) != 0;
+			list[position] = other;
+			setEdgePosition(axis, position);
+			position--;
+			list[position] = edge;
+			setEdgePosition(axis, position);
+
+			if (isMax != otherIsMax && overlapsOtherAxes(self, otherId, axis)) {
+				if (!isMax) {
+					// Our min went below their max, we started overlapping
+					addPair(self, otherId);
+				}
+				else {
+					// Our max went below their min, we stopped overlapping
+					removePair(self, otherId);
+				}
+			}
+		}
+	}
+
+	void sortUp(int axis, uint32_t position) {
+		std::vector<Edge>& list = edges[axis];
+		Edge edge = list[position];
+		uint32_t self = edge.proxy() & ~MAX_FLAG;
+		bool isMax = (edge.proxy() & MAX_FLAG) != 0;
+		while (position + 1 < list.size() && edgeLess(list[position + 1], edge)) {
+			const Edge& other = list[position + 1];
+			uint32_t otherId = other.proxy() & ~MAX_FLAG;
+			bool otherIsMax = (other.proxy() & MAX_FLAG) != 0;
+			list[position] = other;
+			setEdgePosition(axis, position);
+			position++;
+			list[position] = edge;
+			setEdgePosition(axis, position);
+
+			if (isMax != otherIsMax && overlapsOtherAxes(self, otherId, axis)) {
+				if (isMax) {
+					// Our max went above their min, we started overlapping
+					addPair(self, otherId);
+				}
+				else {
+					// Our min went above their max, we stopped overlapping
+					removePair(self, otherId);
+				}
+			}
+		}
+	}
+
+	void moveProxy(uint32_t id) {
+		for (int axis = 0; axis < 3; ++axis) {
+			uint32_t newMin = minValue(axis, id);
+			uint32_t newMax = maxValue(axis, id);
+			uint32_t oldMin = edges[axis][minPosition(axis, id)].value();
+			uint32_t oldMax = edges[axis][maxPosition(axis, id)].value();
+			edges[axis][minPosition(axis, id)] = Edge(newMin, id);
+			edges[axis][maxPosition(axis, id)] = Edge(newMax, id | MAX_FLAG);
+
+			// Growing first, then shrinking, so a box never briefly has its min above its max
+			if (newMin < oldMin) {
+				sortDown(axis, minPosition(axis, id));
+			}
+			if (newMax > oldMax) {
+				sortUp(axis, maxPosition(axis, id));
+			}
+			if (newMin > oldMin) {
+				sortUp(axis, minPosition(axis, id));
+			}
+			if (newMax < oldMax) {
+				sortDown(axis, maxPosition(axis, id));
+			}
+		}
+	}
+
+	// Refreshes every endpoint on one axis and insertion sorts the list, which is nearly sorted already, in one pass
+	// Each min passing a max is a pair starting or stopping to overlap on this axis, exactly as in sortDown
+	// The pair tests only read positions on the other axes, so this axis' positions are written once at the end
+	// rather than on every swap
+	void sortAxis(int axis) {
+		std::vector<Edge>& list = edges[axis];
+		const std::vector<uint32_t>& values = bounds[axis];
+		std::vector<uint32_t>& edgePositions = positions[axis];
+		bool swapped = false;
+		for (uint32_t i = 0; i < list.size(); ++i) {
+			uint32_t proxy = list[i].proxy();
+			Edge edge(values[endpointIndex(proxy)], proxy);
+			if (i == 0 || !edgeLess(edge, list[i - 1])) {
+				list[i] = edge;
+				continue;
+			}
+			uint32_t self = proxy & ~MAX_FLAG;
+			bool isMax = (proxy & MAX_FLAG) != 0;
+			uint32_t position = i;
+			do {
+				const Edge& other = list[position - 1];
+				uint32_t otherId = other.proxy() & ~MAX_FLAG;
+				bool otherIsMax = (other.proxy() & MAX_FLAG) != 0;
+				if (isMax != otherIsMax && overlapsOtherAxes(self, otherId, axis)) {
+					if (!isMax) {
+						addPair(self, otherId);
+					}
+					else {
+						removePair(self, otherId);
+					}
+				}
+				list[position] = other;
+				position--;
+			} while (position > 0 && edgeLess(edge, list[position - 1]));
+			list[position] = edge;
+			swapped = true;
+		}
+		if (swapped) {
+			for (uint32_t i = 0; i < list.size(); ++i) {
+				edgePositions[endpointIndex(list[i].proxy())] = i;
+			}
+		}
+	}
+
+	// Drops the endpoints and pairs of every destroyed proxy in one linear pass
+	void removeDeadProxies() {
+		for (int axis = 0; axis < 3; ++axis) {
+			std::vector<Edge>& list = edges[axis];
+			list.erase(std::remove_if(list.begin(), list.end(), [this](const Edge& edge) {
+				return proxies[edge.proxy() & ~MAX_FLAG].owner == nullptr;
+			}), list.end());
+			for (uint32_t i = 0; i < list.size(); ++i) {
+				setEdgePosition(axis, i);
+			}
+		}
+
+		for (size_t i = 0; i < pairs.size();) {
+			uint32_t a = static_cast<uint32_t>(pairKeys[i] >> 32);
+			uint32_t b = static_cast<uint32_t>(pairKeys[i] & 0xffffffffu);
+			if (proxies[a].owner == nullptr || proxies[b].owner == nullptr) {
+				removePair(a, b);
+			}
+			else {
+				++i;
+			}
+		}
+
+		for (uint32_t id = 0; id < proxies.size(); ++id) {
+			if (proxies[id].inserted && proxies[id].owner == nullptr) {
+				proxies[id].inserted = false;
+				freeIds.push_back(id);
+				insertedCount--;
+			}
+		}
+		removedCount = 0;
+	}
+
+	// Merges the endpoints of every pending proxy into the sorted lists in one linear pass per axis,
+	// then finds the new proxies' pairs with a single sweep along x
+	// The first update after loading a scene goes through here with every proxy pending, which is a full sort and sweep
+	void insertPending() {
+		for (uint32_t id : pending) {
+			proxies[id].inserted = true;
+			proxies[id].isNew = true;
+		}
+		insertedCount += pending.size();
+
+		std::vector<Edge> added;
+		for (int axis = 0; axis < 3; ++axis) {
+			added.clear();
+			for (uint32_t id : pending) {
+				added.push_back(Edge(minValue(axis, id), id));
+				added.push_back(Edge(maxValue(axis, id), id | MAX_FLAG));
+			}
+			std::sort(added.begin(), added.end(), edgeLess);
+
+			std::vector<Edge>& list = edges[axis];
+			std::size_t oldSize = list.size();
+			list.insert(list.end(), added.begin(), added.end());
+			std::inplace_merge(list.begin(), list.begin() + oldSize, list.end(), edgeLess);
+			for (uint32_t i = 0; i < list.size(); ++i) {
+				setEdgePosition(axis, i);
+			}
+		}
+
+		// Old proxies already have their pairs, so only pairs involving a new proxy are tested
+		std::vector<uint32_t> activeOld;
+		std::vector<uint32_t> activeNew;
+		for (const Edge& edge : edges[0]) {
+			uint32_t id = edge.proxy() & ~MAX_FLAG;
+			const Proxy& proxy = proxies[id];
+			std::vector<uint32_t>& active = proxy.isNew ? activeNew : activeOld;
+			if (edge.proxy() & MAX_FLAG) {
+				active.erase(std::find(active.begin(), active.end(), id));
+				continue;
+			}
+			for (uint32_t other : activeNew) {
+				testNewPair(id, other);
+			}
+			if (proxy.isNew) {
+				for (uint32_t other : activeOld) {
+					testNewPair(id, other);
+				}
+			}
+			active.push_back(id);
+		}
+
+		for (uint32_t id : pending) {
+			proxies[id].isNew = false;
+		}
+		pending.clear();
+	}
+
+	void testNewPair(uint32_t a, uint32_t b) {
+		// Branch free, most candidates fail on y or z and a branch per test would mispredict
+		if ((minPosition(1, a) <= maxPosition(1, b)) & (minPosition(1, b) <= maxPosition(1, a)) &
+			(minPosition(2, a) <= maxPosition(2, b)) & (minPosition(2, b) <= maxPosition(2, a))) {
+			addPair(a, b);
+		}
+	}
+};
+
+#endif // BROADPHASE_H
@@ -73,6 +73,11 @@ public:
 		view = glm::lookAt(position, position + cameraFront, cameraUp);
 	}
 
+	// Unit vector the camera looks along, a ray from position along it is what's under the crosshair
+	glm::vec3 getFront() const {
+		return cameraFront;
+	}
+
 private:
 	glm::vec3 cameraFront; // Position always in front
 	glm::vec3 cameraRight; // Position always to the right
@@ -0,0 +1,552 @@
+// GltfLoader.h
+#ifndef GLTFLOADER_H
+#define GLTFLOADER_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <string>
+#include <span>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+#include <Meshes.h>
+#include <MappedFile.h>
+#include <Json.h>
+
+// What the last GltfLoader::load read
+struct GltfLoadStats {
+	std::size_t bytes = 0;
+	std::size_t nodes = 0;
+	std::size_t primitives = 0; // triangle lists found in the file's meshes, each is a mesh in the registry
+	std::size_t zeroCopyPrimitives = 0; // registered pointing straight into the mapped file
+	std::size_t mappedUploadPrimitives = 0; // uploaded by the renderer straight from the mapped file, positions, indices or both
+	std::size_t skippedPrimitives = 0; // points, lines and strips, which the renderer can't draw
+	std::size_t bytesCopied = 0; // vertex and index data that had to be converted, everything else stays in the file
+	double milliseconds = 0.0;
+};
+
+// A node of a loaded scene, its transform is local to its parent
+struct GltfNode {
+	std::string name;
+	uint32_t parent = UINT32_MAX; // index into GltfScene::nodes, UINT32_MAX for a root
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+	std::vector<MeshHandle> meshes; // one per triangle list of the node's mesh, nodes sharing a mesh share handles
+};
+
+// Every node of the file's default scene, parents always come before their children
+struct GltfScene {
+	std::vector<GltfNode> nodes;
+};
+
+// -------------------------------------------
+// Declaration of GltfLoader class
+// Reads binary glTF (.glb) files: the file is memory mapped, and triangle lists are registered with
+// MeshRegistry::addMeshView, pointing into the mapped binary chunk wherever the data is laid out the way it's needed
+// Two layouts matter, and with GLM_FORCE_ALIGNED they differ: the registry's spans want positions laid out like
+// glm::vec3 (16 bytes apart) and 32 bit indices, for collisions, casts and levels of detail, while the renderer takes
+// tightly packed float positions (12 bytes apart, the usual layout) and 16 or 32 bit indices as they are
+// So a typical file is copied once into the registry's layout but still uploaded straight from the mapping, each
+// primitive's GpuMeshSource pointing at its buffer views, and only what fits neither (interleaved vertices, 8 bit
+// indices, no indices) goes through addMesh, converted and optimized
+// Only positions are read, external buffers and required extensions aren't supported
+class GltfLoader {
+public:
+	// Registers the meshes in meshRegistry and fills the scene, false with getError set if the file can't be used
+	// With zeroCopy off every mesh is copied and optimized through addMesh, like the offline baker wants
+	bool load(const std::string& path, bool zeroCopy = true) {
+		auto start = std::chrono::steady_clock::now();
+		this->zeroCopy = zeroCopy;
+		scene = GltfScene();
+		stats = GltfLoadStats();
+		error.clear();
+		auto file = std::make_shared<MappedFile>();
+		if (!file->open(path)) {
+			error = "can't open " + path;
+			return false;
+		}
+		stats.bytes = file->size();
+		bool ok = loadGlb(file);
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!ok) {
+			scene = GltfScene();
+			error = path + ": " + error;
+		}
+		return ok;
+	}
+
+	const GltfScene& getScene() const {
+		return scene;
+	}
+
+	const GltfLoadStats& getStats() const {
+		return stats;
+	}
+
+	const std::string& getError() const {
+		return error;
+	}
+
+private:
+	GltfScene scene;
+	GltfLoadStats stats;
+	std::string error;
+	bool zeroCopy = true;
+
+	static const uint32_t glbMagic = 0x46546C67; // "glTF"
+	static const uint32_t jsonChunk = 0x4E4F534A; // "JSON"
+	static const uint32_t binChunk = 0x004E4942; // "BIN\0"
+
+	enum ComponentType : uint32_t {
+		UnsignedByte = 5121,
+		UnsignedShort = 5123,
+		UnsignedInt = 5125,
+		Float = 5126,
+	};
+
+	// Keeps a primitive's converted copies, and the file its GpuMeshSource points into, for as long as the registry uses them
+	struct PrimitiveData {
+		std::shared_ptr<MappedFile> file;
+		std::vector<glm::vec3> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// An accessor resolved to where its elements are in the binary chunk
+	struct AccessorView {
+		const uint8_t* data = nullptr;
+		std::size_t count = 0;
+		std::size_t stride = 0;
+		uint32_t componentType = 0;
+	};
+
+	bool fail(const std::string& reason) {
+		error = reason;
+		return false;
+	}
+
+	static uint32_t readU32(const uint8_t* bytes) {
+		uint32_t value;
+		std::memcpy(&value, bytes, sizeof(value));
+		return value;
+	}
+
+	bool loadGlb(const std::shared_ptr<MappedFile>& file) {
+		const uint8_t* bytes = file->data();
+		std::size_t size = file->size();
+		if (size < 20 || readU32(bytes) != glbMagic) {
+			return fail("not a binary glTF file");
+		}
+		if (readU32(bytes + 4) != 2) {
+			return fail("only glTF 2.0 is supported");
+		}
+		size = std::min<std::size_t>(size, readU32(bytes + 8));
+
+		// The JSON chunk comes first and the binary chunk, if there is one, straight after it
+		std::span<const uint8_t> json;
+		std::span<const uint8_t> bin;
+		for (std::size_t offset = 12; offset + 8 <= size;) {
+			std::size_t length = readU32(bytes + offset);
+			uint32_t type = readU32(bytes + offset + 4);
+			if (length > size - offset - 8) {
+				return fail("chunk runs past the end of the file");
+			}
+			if (type == jsonChunk && json.empty()) {
+				json = std::span<const uint8_t>(bytes + offset + 8, length);
+			}
+			else if (type == binChunk && bin.empty()) {
+				bin = std::span<const uint8_t>(bytes + offset + 8, length);
+			}
+			offset += 8 + (length + 3) / 4 * 4;
+		}
+
+		JsonValue document;
+		std::string jsonError;
+		if (!JsonValue::parse(std::string_view(reinterpret_cast<const char*>(json.data()), json.size()), document, &jsonError)) {
+			return fail("invalid JSON chunk, " + jsonError);
+		}
+		if (document["extensionsRequired"].size() > 0) {
+			return fail("requires extension " + document["extensionsRequired"][0].getString());
+		}
+		for (const JsonValue& buffer : document["buffers"].getItems()) {
+			if (buffer.contains("uri")) {
+				return fail("only the binary chunk is supported as a buffer");
+			}
+		}
+
+		// Every glTF mesh is registered once, however many nodes use it
+		const JsonValue& meshes = document["meshes"];
+		std::vector<std::vector<MeshHandle>> meshHandles(meshes.size());
+		for (std::size_t mesh = 0; mesh < meshes.size(); ++mesh) {
+			for (const JsonValue& primitive : meshes[mesh]["primitives"].getItems()) {
+				MeshHandle handle = NO_MESH;
+				if (!loadPrimitive(document, bin, primitive, file, handle)) {
+					error = "mesh " + std::to_string(mesh) + ", " + error;
+					return false;
+				}
+				if (handle != NO_MESH) {
+					meshHandles[mesh].push_back(handle);
+				}
+			}
+		}
+		return loadNodes(document, meshHandles);
+	}
+
+	// Checks the accessor fits inside its buffer view and the view inside the binary chunk
+	bool resolveAccessor(const JsonValue& document, std::span<const uint8_t> bin, std::size_t index, std::size_t elementSize, AccessorView& view) {
+		const JsonValue& accessor = document["accessors"][index];
+		if (!accessor.isObject()) {
+			return fail("accessor " + std::to_string(index) + " doesn't exist");
+		}
+		if (accessor.contains("sparse")) {
+			return fail("sparse accessors aren't supported");
+		}
+		const JsonValue& bufferView = document["bufferViews"][accessor["bufferView"].getIndex()];
+		if (!bufferView.isObject() || bufferView["buffer"].getIndex() != 0) {
+			return fail("accessor " + std::to_string(index) + " has no data in the binary chunk");
+		}
+		std::size_t viewOffset = bufferView["byteOffset"].getIndex(0);
+		std::size_t viewLength = bufferView["byteLength"].getIndex(0);
+		std::size_t offset = accessor["byteOffset"].getIndex(0);
+		view.count = accessor["count"].getIndex(0);
+		view.stride = bufferView["byteStride"].getIndex(0);
+		view.stride = view.stride == 0 ? elementSize : view.stride;
+		view.componentType = static_cast<uint32_t>(accessor["componentType"].getIndex(0));
+		if (viewOffset > bin.size() || viewLength > bin.size() - viewOffset || offset > viewLength || view.stride < elementSize) {
+			return fail("accessor " + std::to_string(index) + " runs past its buffer view");
+		}
+		// The last element only needs its own size after it, not a whole stride
+		std::size_t available = viewLength - offset;
+		if (view.count > 0 && (available < elementSize || view.count - 1 > (available - elementSize) / view.stride)) {
+			return fail("accessor " + std::to_string(index) + " runs past its buffer view");
+		}
+		view.data = bin.data() + viewOffset + offset;
+		return true;
+	}
+
+	bool loadPrimitive(const JsonValue& document, std::span<const uint8_t> bin, const JsonValue& primitive, const std::shared_ptr<MappedFile>& file, MeshHandle& handle) {
+		if (primitive["mode"].getIndex(4) != 4) {
+			stats.skippedPrimitives++;
+			return true;
+		}
+		std::size_t positionIndex = primitive["attributes"]["POSITION"].getIndex();
+		if (positionIndex == SIZE_MAX) {
+			stats.skippedPrimitives++;
+			return true;
+		}
+		// A VEC3 element in the file is three floats, whatever padding glm::vec3 has in this build
+		AccessorView positions;
+		if (!resolveAccessor(document, bin, positionIndex, 3 * sizeof(float), positions)) {
+			return false;
+		}
+		if (positions.componentType != Float || document["accessors"][positionIndex]["type"].getRawString() != "VEC3") {
+			return fail("positions have to be three floats");
+		}
+		if (positions.count > UINT32_MAX) {
+			return fail("too many vertices");
+		}
+		stats.primitives++;
+
+		// Tightly packed positions are what the renderer holds them as, whatever the registry needs
+		GpuMeshSource gpuSource;
+		if (positions.stride == 3 * sizeof(float)) {
+			gpuSource.positions = positions.data;
+		}
+
+		// Positions laid out exactly like glm::vec3 can be used where they are
+		std::vector<glm::vec3> copiedVertices;
+		std::span<const glm::vec3> vertices;
+		if (positions.stride == sizeof(glm::vec3) && reinterpret_cast<uintptr_t>(positions.data) % alignof(glm::vec3) == 0) {
+			vertices = std::span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(positions.data), positions.count);
+		}
+		else {
+			copiedVertices.resize(positions.count);
+			for (std::size_t i = 0; i < positions.count; ++i) {
+				std::memcpy(&copiedVertices[i], positions.data + i * positions.stride, 3 * sizeof(float));
+			}
+			vertices = copiedVertices;
+			stats.bytesCopied += copiedVertices.size() * sizeof(glm::vec3);
+		}
+
+		std::vector<unsigned int> copiedIndices;
+		std::span<const unsigned int> indices;
+		std::size_t indicesIndex = primitive["indices"].getIndex();
+		if (indicesIndex == SIZE_MAX) {
+			// Not indexed, every three vertices are a triangle
+			copiedIndices.resize(positions.count / 3 * 3);
+			for (std::size_t i = 0; i < copiedIndices.size(); ++i) {
+				copiedIndices[i] = static_cast<unsigned int>(i);
+			}
+		}
+		else {
+			uint32_t componentType = static_cast<uint32_t>(document["accessors"][indicesIndex]["componentType"].getIndex(0));
+			std::size_t indexSize = componentType == UnsignedByte ? 1 : componentType == UnsignedShort ? 2 : componentType == UnsignedInt ? 4 : 0;
+			if (indexSize == 0) {
+				return fail("indices have to be unsigned integers");
+			}
+			AccessorView view;
+			if (!resolveAccessor(document, bin, indicesIndex, indexSize, view)) {
+				return false;
+			}
+			if (indexSize > 1 && view.stride == indexSize) {
+				gpuSource.indices = view.data;
+				gpuSource.indexSize = static_cast<uint32_t>(indexSize);
+			}
+			if (componentType == UnsignedInt && view.stride == sizeof(uint32_t) && reinterpret_cast<uintptr_t>(view.data) % alignof(unsigned int) == 0) {
+				indices = std::span<const unsigned int>(reinterpret_cast<const unsigned int*>(view.data), view.count / 3 * 3);
+			}
+			else {
+				copiedIndices.resize(view.count / 3 * 3);
+				for (std::size_t i = 0; i < copiedIndices.size(); ++i) {
+					const uint8_t* element = view.data + i * view.stride;
+					if (indexSize == 1) {
+						copiedIndices[i] = *element;
+					}
+					else if (indexSize == 2) {
+						uint16_t index;
+						std::memcpy(&index, element, sizeof(index));
+						copiedIndices[i] = index;
+					}
+					else {
+						std::memcpy(&copiedIndices[i], element, sizeof(uint32_t));
+					}
+				}
+			}
+		}
+		if (indices.data() == nullptr) {
+			indices = copiedIndices;
+			stats.bytesCopied += copiedIndices.size() * sizeof(unsigned int);
+		}
+		// Everything else indexes vertices without checking, so a bad index has to be caught here
+		for (unsigned int index : indices) {
+			if (index >= positions.count) {
+				return fail("index past the last vertex");
+			}
+		}
+
+		bool mappedUpload = gpuSource.positions || gpuSource.indices;
+		if (zeroCopy && copiedVertices.empty() && copiedIndices.empty()) {
+			handle = meshRegistry.addMeshView(vertices, indices, file, gpuSource);
+			stats.zeroCopyPrimitives++;
+			stats.mappedUploadPrimitives += mappedUpload;
+		}
+		else if (zeroCopy && mappedUpload) {
+			// Optimizing would reorder the copies away from the file, so they're registered as they are, with the mapping
+			auto data = std::make_shared<PrimitiveData>();
+			data->file = file;
+			data->vertices = std::move(copiedVertices);
+			data->indices = std::move(copiedIndices);
+			if (!data->vertices.empty()) {
+				vertices = data->vertices;
+			}
+			if (!data->indices.empty()) {
+				indices = data->indices;
+			}
+			handle = meshRegistry.addMeshView(vertices, indices, data, gpuSource);
+			stats.mappedUploadPrimitives++;
+		}
+		else {
+			handle = meshRegistry.addMesh(vertices, indices);
+		}
+		return true;
+	}
+
+	// Walks the default scene from its roots, or every node no other node lists as a child when there are no scenes
+	bool loadNodes(const JsonValue& document, const std::vector<std::vector<MeshHandle>>& meshHandles) {
+		const JsonValue& nodes = document["nodes"];
+		std::vector<std::size_t> roots;
+		const JsonValue& scenes = document["scenes"];
+		if (scenes.size() > 0) {
+			const JsonValue& defaultScene = scenes[document["scene"].getIndex(0)];
+			for (const JsonValue& root : defaultScene["nodes"].getItems()) {
+				roots.push_back(root.getIndex());
+			}
+		}
+		else {
+			std::vector<bool> isChild(nodes.size(), false);
+			for (const JsonValue& node : nodes.getItems()) {
+				for (const JsonValue& child : node["children"].getItems()) {
+					if (child.getIndex() < nodes.size()) {
+						isChild[child.getIndex()] = true;
+					}
+				}
+			}
+			for (std::size_t node = 0; node < nodes.size(); ++node) {
+				if (!isChild[node]) {
+					roots.push_back(node);
+				}
+			}
+		}
+
+		// Each node is reached once, a second visit means the file's hierarchy isn't a tree
+		std::vector<bool> visited(nodes.size(), false);
+		std::vector<std::pair<std::size_t, uint32_t>> pending; // node and its parent in scene.nodes
+		for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+			pending.push_back({ *root, UINT32_MAX });
+		}
+		while (!pending.empty()) {
+			auto [index, parent] = pending.back();
+			pending.pop_back();
+			if (index >= nodes.size() || visited[index]) {
+				return fail("node " + std::to_string(index) + " doesn't exist or has more than one parent");
+			}
+			visited[index] = true;
+			const JsonValue& node = nodes[index];
+			GltfNode loaded;
+			loaded.name = node.contains("name") ? node["name"].getString() : "node " + std::to_string(index);
+			loaded.parent = parent;
+			readTransform(node, loaded);
+			std::size_t mesh = node["mesh"].getIndex();
+			if (mesh < meshHandles.size()) {
+				loaded.meshes = meshHandles[mesh];
+			}
+			uint32_t loadedIndex = static_cast<uint32_t>(scene.nodes.size());
+			scene.nodes.push_back(std::move(loaded));
+			const std::vector<JsonValue>& children = node["children"].getItems();
+			for (auto child = children.rbegin(); child != children.rend(); ++child) {
+				pending.push_back({ child->getIndex(), loadedIndex });
+			}
+		}
+		stats.nodes = scene.nodes.size();
+		return true;
+	}
+
+	// Either a matrix, split back into translation, rotation and scale (shear is lost), or the three separately
+	static void readTransform(const JsonValue& node, GltfNode& loaded) {
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.size() == 16) {
+			glm::mat4 m;
+			for (int i = 0; i < 16; ++i) {
+				m[i / 4][i % 4] = static_cast<float>(matrix[i].getNumber());
+			}
+			loaded.translation = glm::vec3(m[3]);
+			loaded.scale = glm::vec3(glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])));
+			glm::mat3 rotation(glm::vec3(m[0]) / loaded.scale.x, glm::vec3(m[1]) / loaded.scale.y, glm::vec3(m[2]) / loaded.scale.z);
+			// A mirrored matrix keeps a proper rotation by flipping one axis of the scale
+			if (glm::determinant(rotation) < 0.0f) {
+				loaded.scale.x = -loaded.scale.x;
+				rotation[0] = -rotation[0];
+			}
+			loaded.rotation = glm::normalize(glm::quat_cast(rotation));
+			return;
+		}
+		const JsonValue& translation = node["translation"];
+		if (translation.size() == 3) {
+			loaded.translation = glm::vec3(translation[0].getNumber(), translation[1].getNumber(), translation[2].getNumber());
+		}
+		// glTF stores quaternions as x, y, z, w
+		const JsonValue& rotation = node["rotation"];
+		if (rotation.size() == 4) {
+			loaded.rotation = glm::normalize(glm::quat(static_cast<float>(rotation[3].getNumber()), static_cast<float>(rotation[0].getNumber()),
+				static_cast<float>(rotation[1].getNumber()), static_cast<float>(rotation[2].getNumber())));
+		}
+		const JsonValue& scale = node["scale"];
+		if (scale.size() == 3) {
+			loaded.scale = glm::vec3(scale[0].getNumber(1.0), scale[1].getNumber(1.0), scale[2].getNumber(1.0));
+		}
+	}
+};
+
+// Writes a small .glb with the same quad three times, scaled by 1, 2 and 3: tightly packed positions with no byteStride,
+// an explicit byteStride of 12, and positions padded to 16 bytes, all sharing one 32 bit index list
+// Loads it and checks each mesh came out with the right positions, and that what the renderer uploads straight from the
+// file matches them, then clears meshRegistry and deletes the file
+// Built with the engine's own glm defines, so it catches the loader assuming a VEC3 element is sizeof(glm::vec3)
+inline bool checkGltfLoader() {
+	const float quad[4][3] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } };
+	const uint32_t quadIndices[6] = { 0, 1, 2, 2, 3, 0 };
+	std::vector<uint8_t> bin(192, 0);
+	auto putFloat = [&bin](std::size_t offset, float value) { std::memcpy(bin.data() + offset, &value, sizeof(value)); };
+	for (int vertex = 0; vertex < 4; ++vertex) {
+		for (int axis = 0; axis < 3; ++axis) {
+			putFloat(vertex * 12 + axis * 4, quad[vertex][axis]);
+			putFloat(80 + vertex * 12 + axis * 4, 2.0f * quad[vertex][axis]);
+			putFloat(128 + vertex * 16 + axis * 4, 3.0f * quad[vertex][axis]);
+		}
+		putFloat(128 + vertex * 16 + 12, -1.0f); // padding, never part of a position
+	}
+	std::memcpy(bin.data() + 48, quadIndices, sizeof(quadIndices));
+
+	std::string json = R"({"asset":{"version":"2.0"},"buffers":[{"byteLength":192}],)"
+		R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":48},{"buffer":0,"byteOffset":48,"byteLength":24},)"
+		R"({"buffer":0,"byteOffset":80,"byteLength":48,"byteStride":12},{"buffer":0,"byteOffset":128,"byteLength":64,"byteStride":16}],)"
+		R"("accessors":[{"bufferView":0,"componentType":5126,"count":4,"type":"VEC3"},)"
+		R"({"bufferView":1,"componentType":5125,"count":6,"type":"SCALAR"},)"
+		R"({"bufferView":2,"componentType":5126,"count":4,"type":"VEC3"},{"bufferView":3,"componentType":5126,"count":4,"type":"VEC3"}],)"
+		R"("meshes":[{"primitives":[{"attributes":{"POSITION":0},"indices":1},{"attributes":{"POSITION":2},"indices":1},)"
+		R"({"attributes":{"POSITION":3},"indices":1}]}],"nodes":[{"mesh":0}],"scenes":[{"nodes":[0]}]})";
+	// Padded so the binary chunk, and with it the 16 byte view, starts 16 byte aligned in the file
+	while ((12 + 8 + json.size() + 8) % 16 != 0) {
+		json += ' ';
+	}
+
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "silly_gl_gltf_check.glb";
+	{
+		std::ofstream out(path, std::ios::binary);
+		auto putU32 = [&out](uint32_t value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+		putU32(0x46546C67);
+		putU32(2);
+		putU32(static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()));
+		putU32(static_cast<uint32_t>(json.size()));
+		putU32(0x4E4F534A);
+		out.write(json.data(), json.size());
+		putU32(static_cast<uint32_t>(bin.size()));
+		putU32(0x004E4942);
+		out.write(reinterpret_cast<const char*>(bin.data()), bin.size());
+	}
+
+	GltfLoader loader;
+	bool ok = loader.load(path.string());
+	if (!ok) {
+		std::cout << "glTF loader check: " << loader.getError() << "\n";
+	}
+	else if (loader.getScene().nodes.size() != 1 || loader.getScene().nodes[0].meshes.size() != 3) {
+		std::cout << "glTF loader check: expected one node with three meshes\n";
+		ok = false;
+	}
+	for (std::size_t primitive = 0; ok && primitive < 3; ++primitive) {
+		// Registering may weld and reorder, so each vertex only has to be one of the quad's corners
+		const Mesh& mesh = meshRegistry.getMesh(loader.getScene().nodes[0].meshes[primitive]);
+		float scale = static_cast<float>(primitive + 1);
+		bool matches = mesh.vertices.size() == 4 && mesh.indices.size() == 6 &&
+			mesh.boundsMin == glm::vec3(0.0f) && mesh.boundsMax == glm::vec3(scale, scale, 0.0f);
+		for (const glm::vec3& vertex : mesh.vertices) {
+			matches &= std::any_of(std::begin(quad), std::end(quad), [&](const float* corner) {
+				return vertex == scale * glm::vec3(corner[0], corner[1], corner[2]);
+			});
+		}
+		// What the renderer would upload from the file has to be the same vertices and triangles, in the same order
+		for (std::size_t i = 0; matches && mesh.gpuSource.positions && i < mesh.vertices.size(); ++i) {
+			float packed[3];
+			std::memcpy(packed, static_cast<const uint8_t*>(mesh.gpuSource.positions) + i * sizeof(packed), sizeof(packed));
+			matches = mesh.vertices[i] == glm::vec3(packed[0], packed[1], packed[2]);
+		}
+		matches &= mesh.gpuSource.indices && mesh.gpuSource.indexSize == sizeof(uint32_t) &&
+			std::memcmp(mesh.gpuSource.indices, mesh.indices.data(), mesh.indices.size_bytes()) == 0;
+		if (!matches) {
+			std::cout << "glTF loader check: positions of primitive " << primitive << " were read wrongly\n";
+			ok = false;
+		}
+	}
+	if (ok) {
+		const GltfLoadStats& stats = loader.getStats();
+		std::cout << "glTF loader check passed, sizeof(glm::vec3) " << sizeof(glm::vec3) << ", " << stats.zeroCopyPrimitives
+			<< " of " << stats.primitives << " primitives zero copy, " << stats.mappedUploadPrimitives << " uploaded from the file\n";
+	}
+	meshRegistry.clear();
+	std::error_code ignored;
+	std::filesystem::remove(path, ignored);
+	return ok;
+}
+
+#endif
@@ -0,0 +1,213 @@
+// Hierarchy.h
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include <SoA.h>
+
+const uint32_t NO_SLOT = UINT32_MAX;
+
+// -------------------------------------------
+// Declaration of TransformHierarchy class
+// Parent and child links between transform slots, plus a flattened copy of every linked slot ordered by depth
+// Parents always come before their children in that order, so one front to back pass can bring every
+// world matrix up to date, and a moved parent only needs its own dirty flag for its whole subtree to follow
+// The order is rebuilt lazily after links change, which is expected to be much rarer than movement
+class TransformHierarchy {
+public:
+	// Slot bookkeeping, kept in step with TransformStorage
+	void addSlot() {
+		links.push_back(Links());
+		nodeOfSlot.push_back(NO_NODE);
+	}
+
+	// Moves slot from into slot to, which must already be unlinked, then the last slot is popped
+	void moveSlot(uint32_t from, uint32_t to) {
+		if (from != to) {
+			Links& moved = links[to];
+			moved = links[from];
+			if (moved.parent != NO_SLOT && links[moved.parent].firstChild == from) {
+				links[moved.parent].firstChild = to;
+			}
+			if (moved.previousSibling != NO_SLOT) {
+				links[moved.previousSibling].nextSibling = to;
+			}
+			if (moved.nextSibling != NO_SLOT) {
+				links[moved.nextSibling].previousSibling = to;
+			}
+			for (uint32_t child = moved.firstChild; child != NO_SLOT; child = links[child].nextSibling) {
+				links[child].parent = to;
+			}
+			nodeOfSlot[to] = nodeOfSlot[from];
+			if (nodeOfSlot[to] != NO_NODE) {
+				nodeSlots[nodeOfSlot[to]] = to;
+			}
+		}
+		links.pop_back();
+		nodeOfSlot.pop_back();
+	}
+
+	// Links child under parent, child must not be linked to a parent already
+	void attach(uint32_t child, uint32_t parent) {
+		Links& childLinks = links[child];
+		childLinks.parent = parent;
+		childLinks.previousSibling = NO_SLOT;
+		childLinks.nextSibling = links[parent].firstChild;
+		if (childLinks.nextSibling != NO_SLOT) {
+			links[childLinks.nextSibling].previousSibling = child;
+		}
+		links[parent].firstChild = child;
+		structureChanged = true;
+	}
+
+	// Unlinks slot from its parent, its own children stay attached to it
+	void detach(uint32_t slot) {
+		Links& slotLinks = links[slot];
+		if (slotLinks.parent == NO_SLOT) {
+			return;
+		}
+		if (slotLinks.previousSibling != NO_SLOT) {
+			links[slotLinks.previousSibling].nextSibling = slotLinks.nextSibling;
+		}
+		else {
+			links[slotLinks.parent].firstChild = slotLinks.nextSibling;
+		}
+		if (slotLinks.nextSibling != NO_SLOT) {
+			links[slotLinks.nextSibling].previousSibling = slotLinks.previousSibling;
+		}
+		slotLinks.parent = NO_SLOT;
+		slotLinks.previousSibling = NO_SLOT;
+		slotLinks.nextSibling = NO_SLOT;
+		structureChanged = true;
+	}
+
+	uint32_t getParent(uint32_t slot) const {
+		return links[slot].parent;
+	}
+
+	uint32_t getFirstChild(uint32_t slot) const {
+		return links[slot].firstChild;
+	}
+
+	uint32_t getNextSibling(uint32_t slot) const {
+		return links[slot].nextSibling;
+	}
+
+	bool isAncestor(uint32_t ancestor, uint32_t slot) const {
+		for (uint32_t parent = links[slot].parent; parent != NO_SLOT; parent = links[parent].parent) {
+			if (parent == ancestor) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Slots with a parent or children get their model matrix from the hierarchy pass instead of on their own
+	bool isInHierarchy(uint32_t slot) const {
+		return links[slot].parent != NO_SLOT || links[slot].firstChild != NO_SLOT;
+	}
+
+	// Flags one slot as moved, its descendants are picked up by the next pass
+	void markDirty(uint32_t slot) {
+		uint32_t node = nodeOfSlot[slot];
+		if (node != NO_NODE) {
+			nodeDirty[node] = 1;
+			anyDirty = true;
+		}
+	}
+
+	bool needsUpdate() const {
+		return anyDirty || structureChanged;
+	}
+
+	bool hasNodes() const {
+		return !nodeSlots.empty() || structureChanged;
+	}
+
+	std::size_t getNodeCount() const {
+		return nodeSlots.size();
+	}
+
+	// Recomputes world = parent world * local for every dirty node and everything below it, in one pass over the depth order
+	// Every slot it touches has its model matrix replaced, then changed(slot) is called
+	template <typename Changed>
+	void update(const SoAVec3& positions, const SoAQuat& rotations, const SoAVec3& scales, AlignedVector<glm::mat4>& models, Changed changed) {
+		if (structureChanged) {
+			rebuildOrder();
+		}
+		for (std::size_t node = 0; node < nodeSlots.size(); ++node) {
+			uint32_t parent = nodeParents[node];
+			// A parent's flag already says whether it changed in this pass
+			if (!nodeDirty[node] && (parent == NO_NODE || !nodeDirty[parent])) {
+				continue;
+			}
+			nodeDirty[node] = 1;
+			uint32_t slot = nodeSlots[node];
+			glm::mat4 local = glm::translate(glm::mat4(1.0f), positions.get(slot));
+			local *= glm::mat4_cast(rotations.get(slot));
+			local = glm::scale(local, scales.get(slot));
+			worlds[node] = parent == NO_NODE ? local : worlds[parent] * local;
+			models[slot] = worlds[node];
+			changed(slot);
+		}
+		std::fill(nodeDirty.begin(), nodeDirty.end(), 0);
+		anyDirty = false;
+	}
+
+private:
+	static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+	// Intrusive child list per slot
+	struct Links {
+		uint32_t parent = NO_SLOT;
+		uint32_t firstChild = NO_SLOT;
+		uint32_t nextSibling = NO_SLOT;
+		uint32_t previousSibling = NO_SLOT;
+	};
+
+	std::vector<Links> links; // indexed by slot
+	std::vector<uint32_t> nodeOfSlot; // position of each slot in the depth order, NO_NODE if it isn't linked
+
+	// The depth order: every linked slot, roots first, then their children, then grandchildren and so on
+	std::vector<uint32_t> nodeSlots;
+	std::vector<uint32_t> nodeParents; // node index of the parent, NO_NODE for roots
+	std::vector<uint8_t> nodeDirty;
+	AlignedVector<glm::mat4> worlds;
+	bool anyDirty = false;
+	bool structureChanged = false;
+
+	// Breadth first from every root that has children, so each level follows the one above it
+	// Every node comes out dirty, as its parent or depth may have changed
+	void rebuildOrder() {
+		nodeSlots.clear();
+		nodeParents.clear();
+		std::fill(nodeOfSlot.begin(), nodeOfSlot.end(), NO_NODE);
+		for (uint32_t slot = 0; slot < links.size(); ++slot) {
+			if (links[slot].parent == NO_SLOT && links[slot].firstChild != NO_SLOT) {
+				nodeOfSlot[slot] = static_cast<uint32_t>(nodeSlots.size());
+				nodeSlots.push_back(slot);
+				nodeParents.push_back(NO_NODE);
+			}
+		}
+		for (std::size_t node = 0; node < nodeSlots.size(); ++node) {
+			for (uint32_t child = links[nodeSlots[node]].firstChild; child != NO_SLOT; child = links[child].nextSibling) {
+				nodeOfSlot[child] = static_cast<uint32_t>(nodeSlots.size());
+				nodeSlots.push_back(child);
+				nodeParents.push_back(static_cast<uint32_t>(node));
+			}
+		}
+		nodeDirty.assign(nodeSlots.size(), 1);
+		worlds.resize(nodeSlots.size());
+		structureChanged = false;
+	}
+};
+
+#endif // HIERARCHY_H
@@ -70,9 +70,7 @@ public:
 
 		Key scaleCubes = Key(GLFW_KEY_R);
 		scaleCubes.pressFunction = [this]() {
-			for (auto& object : objectManager->getObjectListByName("cube")) {
-				object->scale(glm::vec3(2.0f, 2.0f, 2.0f));
-			}
+			objectManager->scaleObjects(objectManager->getObjectListByName("cube"), glm::vec3(2.0f, 2.0f, 2.0f));
 			};
 		addKey(scaleCubes);
 
@@ -0,0 +1,336 @@
+// JobSystem.h
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// A unit of work, plus the jobs waiting for it to finish
+struct Job {
+	std::function<void()> task;
+	std::atomic<int> pendingDependencies{ 1 }; // unfinished dependencies, plus one held while the job is being scheduled
+	std::atomic<bool> done{ false };
+	std::mutex mutex; // guards finished and continuations
+	bool finished = false;
+	std::vector<std::shared_ptr<Job>> continuations;
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+// Counters summed over every queue since the last resetStats
+struct JobStats {
+	uint64_t jobsExecuted = 0;
+	uint64_t jobsStolen = 0; // jobs taken from another thread's queue
+	uint64_t failedSteals = 0; // times a thread looked at every other queue and found nothing
+	uint64_t idleWaits = 0; // times a worker went to sleep for lack of work
+	double idleSeconds = 0.0; // total time workers spent asleep
+};
+
+// -------------------------------------------
+// Declaration of JobSystem class
+// Work stealing thread pool: every worker has its own deque and takes its newest job first, which keeps
+// recently touched data in cache, and when it runs dry it steals the oldest job from another queue
+// Threads that aren't workers (the main thread) share queue 0, and help run jobs while they wait
+class JobSystem {
+public:
+	// One worker per core besides the main thread by default
+	explicit JobSystem(unsigned workerCount = defaultWorkerCount()) {
+		start(workerCount);
+	}
+
+	~JobSystem() {
+		stop();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	static unsigned defaultWorkerCount() {
+		unsigned cores = std::thread::hardware_concurrency();
+		return cores > 1 ? cores - 1 : 1;
+	}
+
+	// Finishes every scheduled job, then restarts with the new number of workers
+	// With zero workers jobs only run on threads that wait for them
+	void setWorkerCount(unsigned workerCount) {
+		stop();
+		start(workerCount);
+	}
+
+	unsigned getWorkerCount() const {
+		return static_cast<unsigned>(workers.size());
+	}
+
+	// The job starts once every dependency has finished, null handles are ignored
+	JobHandle schedule(std::function<void()> task, std::span<const JobHandle> dependencies = {}) {
+		JobHandle job = std::make_shared<Job>();
+		job->task = std::move(task);
+		job->pendingDependencies.store(static_cast<int>(dependencies.size()) + 1);
+		outstandingJobs++;
+		for (const auto& dependency : dependencies) {
+			if (!dependency || !addContinuation(dependency, job)) {
+				job->pendingDependencies--;
+			}
+		}
+		// Dropping the scheduling reference, whichever of this and the last dependency finishes second queues the job
+		if (job->pendingDependencies.fetch_sub(1) == 1) {
+			enqueue(job);
+		}
+		return job;
+	}
+
+	JobHandle schedule(std::function<void()> task, std::initializer_list<JobHandle> dependencies) {
+		return schedule(std::move(task), std::span<const JobHandle>(dependencies.begin(), dependencies.size()));
+	}
+
+	// Runs other jobs until this one has finished
+	void wait(const JobHandle& job) {
+		std::size_t queue = currentQueue();
+		while (!job->done.load(std::memory_order_acquire)) {
+			if (!runOneJob(queue)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Runs jobs until everything scheduled so far, and everything those jobs scheduled, has finished
+	void waitAll() {
+		std::size_t queue = currentQueue();
+		while (outstandingJobs.load(std::memory_order_acquire) > 0) {
+			if (!runOneJob(queue)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Calls body(first, last) over [begin, end) split into chunks of at least grainSize, and returns once all are done
+	// The calling thread runs chunks too, so this is safe to call from inside a job
+	template <typename Body>
+	void parallelFor(std::size_t begin, std::size_t end, std::size_t grainSize, Body body) {
+		if (end <= begin) {
+			return;
+		}
+		if (workers.empty()) {
+			body(begin, end);
+			return;
+		}
+		std::size_t count = end - begin;
+		grainSize = std::max<std::size_t>(grainSize, 1);
+		// A few chunks per thread so an early finisher has something left to steal
+		std::size_t maxChunks = (workers.size() + 1) * 4;
+		std::size_t chunkCount = std::min((count + grainSize - 1) / grainSize, maxChunks);
+		if (chunkCount <= 1) {
+			body(begin, end);
+			return;
+		}
+		std::size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+		std::vector<JobHandle> chunks;
+		chunks.reserve(chunkCount);
+		// The first chunk is kept for this thread
+		for (std::size_t first = begin + chunkSize; first < end; first += chunkSize) {
+			std::size_t last = std::min(first + chunkSize, end);
+			chunks.push_back(schedule([&body, first, last]() {
+				body(first, last);
+			}));
+		}
+		body(begin, std::min(begin + chunkSize, end));
+		for (const auto& chunk : chunks) {
+			wait(chunk);
+		}
+	}
+
+	JobStats getStats() const {
+		JobStats stats;
+		for (const auto& queue : queues) {
+			stats.jobsExecuted += queue->jobsExecuted.load(std::memory_order_relaxed);
+			stats.jobsStolen += queue->jobsStolen.load(std::memory_order_relaxed);
+			stats.failedSteals += queue->failedSteals.load(std::memory_order_relaxed);
+			stats.idleWaits += queue->idleWaits.load(std::memory_order_relaxed);
+			stats.idleSeconds += queue->idleNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+		}
+		return stats;
+	}
+
+	void resetStats() {
+		for (auto& queue : queues) {
+			queue->jobsExecuted = 0;
+			queue->jobsStolen = 0;
+			queue->failedSteals = 0;
+			queue->idleWaits = 0;
+			queue->idleNanoseconds = 0;
+		}
+	}
+
+private:
+	// One deque per thread, the owner works at the back and thieves take from the front
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+		std::atomic<uint64_t> jobsExecuted{ 0 };
+		std::atomic<uint64_t> jobsStolen{ 0 };
+		std::atomic<uint64_t> failedSteals{ 0 };
+		std::atomic<uint64_t> idleWaits{ 0 };
+		std::atomic<uint64_t> idleNanoseconds{ 0 };
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> queues; // queue 0 is shared by every non-worker thread
+	std::vector<std::thread> workers;
+	std::atomic<int> queuedJobs{ 0 }; // jobs sitting in a queue, sleeping workers wake when this goes up
+	std::atomic<int> outstandingJobs{ 0 }; // scheduled and not yet finished
+	std::atomic<bool> stopping{ false };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	// Which queue the calling thread owns, set on each worker thread
+	static inline thread_local const JobSystem* workerOwner = nullptr;
+	static inline thread_local std::size_t workerQueue = 0;
+
+	std::size_t currentQueue() const {
+		return workerOwner == this ? workerQueue : 0;
+	}
+
+	void start(unsigned workerCount) {
+		stopping = false;
+		queues.clear();
+		for (unsigned i = 0; i <= workerCount; ++i) {
+			queues.push_back(std::make_unique<WorkQueue>());
+		}
+		for (unsigned i = 1; i <= workerCount; ++i) {
+			workers.emplace_back([this, i]() {
+				workerLoop(i);
+			});
+		}
+	}
+
+	void stop() {
+		waitAll();
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	// Returns false if the dependency had already finished, so nothing needs to wait on it
+	static bool addContinuation(const JobHandle& dependency, const JobHandle& job) {
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->finished) {
+			return false;
+		}
+		dependency->continuations.push_back(job);
+		return true;
+	}
+
+	void enqueue(const JobHandle& job) {
+		WorkQueue& queue = *queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+		queuedJobs++;
+		// Taking the lock orders this against a worker checking queuedJobs just before it sleeps
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+
+	JobHandle findJob(std::size_t own) {
+		{
+			WorkQueue& queue = *queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				JobHandle job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				queuedJobs--;
+				return job;
+			}
+		}
+		for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+			WorkQueue& victim = *queues[(own + offset) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.jobs.empty()) {
+				JobHandle job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				queuedJobs--;
+				queues[own]->jobsStolen.fetch_add(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+		if (queues.size() > 1) {
+			queues[own]->failedSteals.fetch_add(1, std::memory_order_relaxed);
+		}
+		return nullptr;
+	}
+
+	bool runOneJob(std::size_t queue) {
+		JobHandle job = findJob(queue);
+		if (!job) {
+			return false;
+		}
+		job->task();
+		queues[queue]->jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+		finish(job);
+		return true;
+	}
+
+	// Marks the job done and queues any continuation it was the last dependency of
+	void finish(const JobHandle& job) {
+		std::vector<JobHandle> continuations;
+		{
+			std::lock_guard<std::mutex> lock(job->mutex);
+			job->finished = true;
+			continuations.swap(job->continuations);
+		}
+		for (const auto& continuation : continuations) {
+			if (continuation->pendingDependencies.fetch_sub(1) == 1) {
+				enqueue(continuation);
+			}
+		}
+		job->done.store(true, std::memory_order_release);
+		outstandingJobs.fetch_sub(1, std::memory_order_release);
+	}
+
+	void workerLoop(std::size_t queue) {
+		workerOwner = this;
+		workerQueue = queue;
+		while (true) {
+			if (runOneJob(queue)) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			if (stopping) {
+				return;
+			}
+			if (queuedJobs.load() > 0) {
+				continue;
+			}
+			auto sleepStart = std::chrono::steady_clock::now();
+			wake.wait(lock, [this]() {
+				return stopping || queuedJobs.load() > 0;
+			});
+			queues[queue]->idleWaits.fetch_add(1, std::memory_order_relaxed);
+			queues[queue]->idleNanoseconds.fetch_add(static_cast<uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sleepStart).count()),
+				std::memory_order_relaxed);
+		}
+	}
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,332 @@
+// Json.h
+#ifndef JSON_H
+#define JSON_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+
+// -------------------------------------------
+// Declaration of JsonValue class
+// A parsed JSON document, strings and keys are views into the text it was parsed from, which has to outlive it
+// Escapes in strings are left as written until getString is asked for
+class JsonValue {
+public:
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type getType() const {
+		return type;
+	}
+
+	bool isNull() const {
+		return type == Type::Null;
+	}
+
+	bool isNumber() const {
+		return type == Type::Number;
+	}
+
+	bool isString() const {
+		return type == Type::String;
+	}
+
+	bool isArray() const {
+		return type == Type::Array;
+	}
+
+	bool isObject() const {
+		return type == Type::Object;
+	}
+
+	double getNumber(double fallback = 0.0) const {
+		return type == Type::Number ? number : fallback;
+	}
+
+	// Negative, fractional or missing numbers give the fallback
+	std::size_t getIndex(std::size_t fallback = SIZE_MAX) const {
+		if (type != Type::Number || number < 0.0 || number > 9007199254740992.0 || number != static_cast<double>(static_cast<uint64_t>(number))) {
+			return fallback;
+		}
+		return static_cast<std::size_t>(number);
+	}
+
+	bool getBool(bool fallback = false) const {
+		return type == Type::Bool ? boolean : fallback;
+	}
+
+	// The string as written, escapes included
+	std::string_view getRawString() const {
+		return type == Type::String ? text : std::string_view();
+	}
+
+	// The string with its escapes decoded, \u escapes become UTF-8
+	std::string getString() const {
+		std::string result;
+		if (type != Type::String) {
+			return result;
+		}
+		result.reserve(text.size());
+		for (std::size_t i = 0; i < text.size(); ++i) {
+			if (text[i] != '\\' || i + 1 >= text.size()) {
+				result += text[i];
+				continue;
+			}
+			char escaped = text[++i];
+			switch (escaped) {
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'n': result += '\n'; break;
+			case 'r': result += '\r'; break;
+			case 't': result += '\t'; break;
+			case 'u': {
+				uint32_t codePoint = 0;
+				if (i + 4 < text.size() && std::from_chars(text.data() + i + 1, text.data() + i + 5, codePoint, 16).ptr == text.data() + i + 5) {
+					i += 4;
+					appendUtf8(result, codePoint);
+				}
+				break;
+			}
+			default: result += escaped; break;
+			}
+		}
+		return result;
+	}
+
+	// Elements of an array, empty for anything else
+	const std::vector<JsonValue>& getItems() const {
+		return items;
+	}
+
+	std::size_t size() const {
+		return type == Type::Object ? members.size() : items.size();
+	}
+
+	const JsonValue& operator[](std::size_t index) const {
+		return index < items.size() ? items[index] : nullValue();
+	}
+
+	// Members of an object in the order they were written
+	const std::vector<std::pair<std::string_view, JsonValue>>& getMembers() const {
+		return members;
+	}
+
+	// The member's value, null if there's no such member or this isn't an object
+	const JsonValue& operator[](std::string_view key) const {
+		for (const auto& member : members) {
+			if (member.first == key) {
+				return member.second;
+			}
+		}
+		return nullValue();
+	}
+
+	bool contains(std::string_view key) const {
+		for (const auto& member : members) {
+			if (member.first == key) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Parses a whole document, false if it isn't valid JSON, error then says what went wrong and where
+	static bool parse(std::string_view text, JsonValue& value, std::string* error = nullptr) {
+		Parser parser(text);
+		value = JsonValue();
+		if (!parser.parseValue(value, 0)) {
+			if (error) {
+				*error = parser.error + " at byte " + std::to_string(parser.p - parser.begin);
+			}
+			value = JsonValue();
+			return false;
+		}
+		parser.skipSpaces();
+		if (parser.p != parser.end) {
+			if (error) {
+				*error = "unexpected text after the document at byte " + std::to_string(parser.p - parser.begin);
+			}
+			value = JsonValue();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string_view text;
+	std::vector<JsonValue> items;
+	std::vector<std::pair<std::string_view, JsonValue>> members;
+
+	static const JsonValue& nullValue() {
+		static const JsonValue null;
+		return null;
+	}
+
+	static void appendUtf8(std::string& out, uint32_t codePoint) {
+		if (codePoint < 0x80) {
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800) {
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else {
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	// Recursive descent, nesting is limited so a hostile file can't run the stack out
+	struct Parser {
+		const char* begin;
+		const char* p;
+		const char* end;
+		std::string error;
+
+		static const int maxDepth = 128;
+
+		explicit Parser(std::string_view text) : begin(text.data()), p(text.data()), end(text.data() + text.size()) {}
+
+		bool fail(const char* reason) {
+			error = reason;
+			return false;
+		}
+
+		void skipSpaces() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+				++p;
+			}
+		}
+
+		bool literal(std::string_view word) {
+			if (static_cast<std::size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word) {
+				return fail("unknown literal");
+			}
+			p += word.size();
+			return true;
+		}
+
+		bool parseString(std::string_view& out) {
+			++p; // opening quote
+			const char* start = p;
+			while (p < end && *p != '"') {
+				if (static_cast<unsigned char>(*p) < 0x20) {
+					return fail("control character in string");
+				}
+				p += *p == '\\' ? 2 : 1;
+			}
+			if (p >= end) {
+				return fail("unterminated string");
+			}
+			out = std::string_view(start, p - start);
+			++p;
+			return true;
+		}
+
+		bool parseValue(JsonValue& value, int depth) {
+			if (depth > maxDepth) {
+				return fail("nested too deeply");
+			}
+			skipSpaces();
+			if (p >= end) {
+				return fail("unexpected end");
+			}
+			switch (*p) {
+			case '{': {
+				value.type = Type::Object;
+				++p;
+				skipSpaces();
+				if (p < end && *p == '}') {
+					++p;
+					return true;
+				}
+				while (true) {
+					skipSpaces();
+					if (p >= end || *p != '"') {
+						return fail("expected a key");
+					}
+					std::string_view key;
+					if (!parseString(key)) {
+						return false;
+					}
+					skipSpaces();
+					if (p >= end || *p != ':') {
+						return fail("expected ':'");
+					}
+					++p;
+					value.members.emplace_back(key, JsonValue());
+					if (!parseValue(value.members.back().second, depth + 1)) {
+						return false;
+					}
+					skipSpaces();
+					if (p < end && *p == ',') {
+						++p;
+						continue;
+					}
+					if (p < end && *p == '}') {
+						++p;
+						return true;
+					}
+					return fail("expected ',' or '}'");
+				}
+			}
+			case '[': {
+				value.type = Type::Array;
+				++p;
+				skipSpaces();
+				if (p < end && *p == ']') {
+					++p;
+					return true;
+				}
+				while (true) {
+					value.items.emplace_back();
+					if (!parseValue(value.items.back(), depth + 1)) {
+						return false;
+					}
+					skipSpaces();
+					if (p < end && *p == ',') {
+						++p;
+						continue;
+					}
+					if (p < end && *p == ']') {
+						++p;
+						return true;
+					}
+					return fail("expected ',' or ']'");
+				}
+			}
+			case '"':
+				value.type = Type::String;
+				return parseString(value.text);
+			case 't':
+				value.type = Type::Bool;
+				value.boolean = true;
+				return literal("true");
+			case 'f':
+				value.type = Type::Bool;
+				return literal("false");
+			case 'n':
+				return literal("null");
+			default: {
+				// from_chars doesn't take a leading '+', which JSON doesn't allow either
+				value.type = Type::Number;
+				std::from_chars_result parsed = std::from_chars(p, end, value.number);
+				if (parsed.ec != std::errc() || parsed.ptr == p) {
+					return fail("invalid number");
+				}
+				p = parsed.ptr;
+				return true;
+			}
+			}
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,165 @@
+// MappedFile.h
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <span>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -------------------------------------------
+// Declaration of MappedFile class
+// A whole file mapped read only into memory, pages are read in by the OS as they're touched
+// Nothing is copied, so loaders can parse or point straight into the bytes for as long as the file stays open
+class MappedFile {
+public:
+	MappedFile() = default;
+
+	explicit MappedFile(const std::string& path) {
+		open(path);
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	MappedFile& operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			close();
+			bytes = std::exchange(other.bytes, nullptr);
+			length = std::exchange(other.length, 0);
+#if defined(_WIN32)
+			mapping = std::exchange(other.mapping, nullptr);
+#endif
+		}
+		return *this;
+	}
+
+	// False if the file can't be opened or mapped, an empty file opens fine with no bytes
+	// sequential hints that the file will be read front to back, so the OS reads ahead more aggressively
+	bool open(const std::string& path, bool sequential = true) {
+		close();
+#if defined(_WIN32)
+		DWORD flags = sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			return false;
+		}
+		if (fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return true;
+		}
+		// The mapping keeps the file open, so the file handle can go straight away
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) {
+			return false;
+		}
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+			return false;
+		}
+		bytes = static_cast<const uint8_t*>(view);
+		length = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode)) {
+			::close(file);
+			return false;
+		}
+		if (status.st_size == 0) {
+			::close(file);
+			return true;
+		}
+		// The mapping keeps the file open, so the descriptor can go straight away
+		void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (view == MAP_FAILED) {
+			return false;
+		}
+		if (sequential) {
+			madvise(view, static_cast<std::size_t>(status.st_size), MADV_SEQUENTIAL);
+		}
+		bytes = static_cast<const uint8_t*>(view);
+		length = static_cast<std::size_t>(status.st_size);
+#endif
+		return true;
+	}
+
+	void close() {
+		if (bytes) {
+#if defined(_WIN32)
+			UnmapViewOfFile(bytes);
+#else
+			munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+		}
+#if defined(_WIN32)
+		if (mapping) {
+			CloseHandle(mapping);
+			mapping = nullptr;
+		}
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+	const uint8_t* data() const {
+		return bytes;
+	}
+
+	std::size_t size() const {
+		return length;
+	}
+
+	bool empty() const {
+		return length == 0;
+	}
+
+	std::span<const uint8_t> getBytes() const {
+		return std::span<const uint8_t>(bytes, length);
+	}
+
+private:
+	const uint8_t* bytes = nullptr;
+	std::size_t length = 0;
+#if defined(_WIN32)
+	HANDLE mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,315 @@
+// MeshOptimizer.h
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Post-transform cache size the orderings are tuned for and measured with, about what current GPUs reuse
+const uint32_t VERTEX_CACHE_SIZE = 16;
+
+// How often the post-transform cache misses, lower is better
+// ACMR is misses per triangle: 0.5 is the ideal for a large grid, 3 means no reuse at all
+// ATVR is misses per vertex used: 1 means every vertex is transformed exactly once
+struct VertexCacheStats {
+	std::size_t misses = 0;
+	std::size_t triangles = 0;
+	std::size_t vertices = 0;
+
+	float acmr() const {
+		return triangles == 0 ? 0.0f : static_cast<float>(misses) / triangles;
+	}
+
+	float atvr() const {
+		return vertices == 0 ? 0.0f : static_cast<float>(misses) / vertices;
+	}
+
+	VertexCacheStats& operator+=(const VertexCacheStats& other) {
+		misses += other.misses;
+		triangles += other.triangles;
+		vertices += other.vertices;
+		return *this;
+	}
+};
+
+// Replays the indices through a FIFO cache of cacheSize vertices
+inline VertexCacheStats analyzeVertexCache(std::span<const unsigned int> indices, std::size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+	// A vertex is in the cache while fewer than cacheSize misses have happened since it went in
+	std::vector<std::size_t> insertedAt(vertexCount, SIZE_MAX);
+	for (unsigned int index : indices) {
+		if (insertedAt[index] == SIZE_MAX) {
+			stats.vertices++;
+		}
+		if (insertedAt[index] == SIZE_MAX || stats.misses - insertedAt[index] >= cacheSize) {
+			insertedAt[index] = stats.misses++;
+		}
+	}
+	return stats;
+}
+
+// Merges vertices at exactly the same position, vertices hold nothing else so nothing is lost
+// Returns the new vertex count, remap[old] being each old vertex's new index, kept in order of first appearance
+inline std::size_t weldVertices(std::span<const glm::vec3> vertices, std::vector<uint32_t>& remap) {
+	std::vector<uint32_t> order(vertices.size());
+	for (uint32_t v = 0; v < order.size(); ++v) {
+		order[v] = v;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		const glm::vec3& pa = vertices[a];
+		const glm::vec3& pb = vertices[b];
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		if (pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	});
+	// Each vertex first points at the first of its position, then those get numbered in order
+	remap.assign(vertices.size(), 0);
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		bool samePosition = i > 0 && vertices[order[i]] == vertices[order[i - 1]];
+		remap[order[i]] = samePosition ? remap[order[i - 1]] : order[i];
+	}
+	std::vector<uint32_t> numbered(vertices.size(), UINT32_MAX);
+	uint32_t count = 0;
+	for (uint32_t v = 0; v < remap.size(); ++v) {
+		if (remap[v] == v) {
+			numbered[v] = count++;
+		}
+	}
+	for (uint32_t& target : remap) {
+		target = numbered[target];
+	}
+	return count;
+}
+
+// Reorders triangles so consecutive ones share vertices while they're still in the cache (Tipsify, Sander et al. 2007)
+// Fans around one vertex at a time, moving on to whichever just used vertex will be finished before it leaves the cache
+inline void optimizeVertexCache(std::span<unsigned int> indices, std::size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+	const std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+		liveTriangles[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] = offsets[v] + liveTriangles[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+			adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<unsigned int> ordered;
+	ordered.reserve(triangleCount * 3);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> cachedAt(vertexCount, 0); // time each vertex last went into the cache
+	std::vector<uint32_t> deadEnds; // recently used vertices, to fall back on when a fan has nowhere to go
+	std::vector<uint32_t> candidates;
+	uint32_t time = cacheSize + 1;
+	uint32_t scan = 0; // the last resort, goes through the vertices in order once
+	int64_t fan = 0;
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; ++corner) {
+				uint32_t v = indices[triangle * 3 + corner];
+				ordered.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cachedAt[v] > cacheSize) {
+					cachedAt[v] = time++;
+				}
+			}
+		}
+
+		// The candidate that's been in the cache longest, as long as its remaining fan fits before it drops out
+		fan = -1;
+		uint32_t best = 0;
+		for (uint32_t v : candidates) {
+			if (liveTriangles[v] == 0) {
+				continue;
+			}
+			uint32_t age = time - cachedAt[v];
+			uint32_t priority = age + 2 * liveTriangles[v] <= cacheSize ? age : 0;
+			if (fan < 0 || priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+		while (fan < 0 && !deadEnds.empty()) {
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[v] > 0) {
+				fan = v;
+			}
+		}
+		while (fan < 0 && scan < vertexCount) {
+			if (liveTriangles[scan] > 0) {
+				fan = scan;
+			}
+			scan++;
+		}
+	}
+	std::copy(ordered.begin(), ordered.end(), indices.begin());
+}
+
+// Reorders a cache optimized index list so triangles facing outwards, which tend to hide the rest, come first
+// The list is cut into clusters that each start on a cold cache within threshold of the whole list's ACMR, so
+// sorting them costs little cache efficiency (Sander et al. 2007)
+inline void optimizeOverdraw(std::span<unsigned int> indices, std::span<const glm::vec3> vertices, float threshold = 1.05f,
+	uint32_t cacheSize = VERTEX_CACHE_SIZE) {
+	const std::size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+	const float targetAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr() * threshold;
+
+	std::vector<std::size_t> clusterStarts;
+	std::vector<std::size_t> insertedAt(vertices.size(), SIZE_MAX);
+	std::size_t misses = 0, clusterMisses = 0, clusterTriangles = 0;
+	for (std::size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		if (clusterTriangles == 0) {
+			clusterStarts.push_back(triangle);
+			// A fresh cluster assumes an empty cache, misses further back are treated as long gone
+			misses += cacheSize;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			unsigned int index = indices[triangle * 3 + corner];
+			if (insertedAt[index] == SIZE_MAX || misses - insertedAt[index] >= cacheSize) {
+				insertedAt[index] = misses++;
+				clusterMisses++;
+			}
+		}
+		clusterTriangles++;
+		if (static_cast<float>(clusterMisses) <= targetAcmr * clusterTriangles) {
+			clusterMisses = clusterTriangles = 0;
+		}
+	}
+
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+	struct Cluster {
+		std::size_t first, last;
+		float sortKey;
+	};
+	std::vector<Cluster> clusters(clusterStarts.size());
+	std::vector<glm::vec3> centroids(clusters.size()), normals(clusters.size());
+	for (std::size_t c = 0; c < clusters.size(); ++c) {
+		clusters[c].first = clusterStarts[c];
+		clusters[c].last = c + 1 < clusters.size() ? clusterStarts[c + 1] : triangleCount;
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (std::size_t t = clusters[c].first; t < clusters[c].last; ++t) {
+			glm::vec3 a = vertices[indices[t * 3]], b = vertices[indices[t * 3 + 1]], c2 = vertices[indices[t * 3 + 2]];
+			glm::vec3 weighted = glm::cross(b - a, c2 - a); // twice the area along the normal
+			float triangleArea = glm::length(weighted);
+			centroid += (a + b + c2) * (triangleArea / 3.0f);
+			normal += weighted;
+			area += triangleArea;
+		}
+		meshCentre += centroid;
+		meshArea += area;
+		centroids[c] = area > 0.0f ? centroid / area : vertices[indices[clusters[c].first * 3]];
+		float length = glm::length(normal);
+		normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+	}
+	meshCentre = meshArea > 0.0f ? meshCentre / meshArea : glm::vec3(0.0f);
+	for (std::size_t c = 0; c < clusters.size(); ++c) {
+		clusters[c].sortKey = glm::dot(centroids[c] - meshCentre, normals[c]);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<unsigned int> ordered;
+	ordered.reserve(indices.size());
+	for (const Cluster& cluster : clusters) {
+		ordered.insert(ordered.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+	}
+	std::copy(ordered.begin(), ordered.end(), indices.begin());
+}
+
+// Renumbers vertices in the order the indices first use them, so the vertex fetch reads the buffer front to back
+// Vertices no index uses are dropped, returns the new vertex count
+inline std::size_t optimizeVertexFetch(std::span<unsigned int> indices, std::vector<glm::vec3>& vertices) {
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<glm::vec3> ordered;
+	ordered.reserve(vertices.size());
+	for (unsigned int& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+	return vertices.size();
+}
+
+// Statistics from optimizing meshes, summed over every mesh
+struct MeshOptimizationStats {
+	std::size_t meshes = 0;
+	std::size_t verticesBefore = 0; // as given, including duplicates
+	std::size_t verticesAfter = 0;
+	VertexCacheStats cacheBefore; // the indices as given, after welding so only the ordering differs
+	VertexCacheStats cacheAfter;
+	std::size_t unoptimized = 0; // registered in place with MeshRegistry::addMeshView, so not part of the counts above
+
+	MeshOptimizationStats& operator+=(const MeshOptimizationStats& other) {
+		meshes += other.meshes;
+		unoptimized += other.unoptimized;
+		verticesBefore += other.verticesBefore;
+		verticesAfter += other.verticesAfter;
+		cacheBefore += other.cacheBefore;
+		cacheAfter += other.cacheAfter;
+		return *this;
+	}
+};
+
+// The whole pipeline: weld duplicates, order triangles for the vertex cache then for overdraw, and order vertices for fetch
+// The result draws exactly the same triangles, with the same winding
+inline MeshOptimizationStats optimizeMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices,
+	std::vector<glm::vec3>& outVertices, std::vector<unsigned int>& outIndices) {
+	MeshOptimizationStats stats;
+	stats.meshes = 1;
+	stats.verticesBefore = vertices.size();
+
+	std::vector<uint32_t> remap;
+	std::size_t weldedCount = weldVertices(vertices, remap);
+	outVertices.resize(weldedCount);
+	for (std::size_t v = 0; v < vertices.size(); ++v) {
+		outVertices[remap[v]] = vertices[v];
+	}
+	outIndices.resize(indices.size() / 3 * 3);
+	for (std::size_t i = 0; i < outIndices.size(); ++i) {
+		outIndices[i] = remap[indices[i]];
+	}
+	stats.cacheBefore = analyzeVertexCache(outIndices, weldedCount);
+
+	optimizeVertexCache(outIndices, weldedCount);
+	optimizeOverdraw(outIndices, outVertices);
+	stats.verticesAfter = optimizeVertexFetch(outIndices, outVertices);
+	stats.cacheAfter = analyzeVertexCache(outIndices, outVertices.size());
+	return stats;
+}
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,304 @@
+// MeshSimplifier.h
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangle each came from (Garland & Heckbert)
+// Stored as the 10 unique entries of the symmetric 4x4 matrix
+struct Quadric {
+	double xx = 0.0, xy = 0.0, xz = 0.0, xw = 0.0;
+	double yy = 0.0, yz = 0.0, yw = 0.0;
+	double zz = 0.0, zw = 0.0;
+	double ww = 0.0;
+	double weight = 0.0;
+
+	// Plane dot(normal, p) + distance = 0, normal unit length
+	static Quadric fromPlane(glm::dvec3 normal, double distance, double weight) {
+		Quadric q;
+		q.xx = normal.x * normal.x * weight; q.xy = normal.x * normal.y * weight; q.xz = normal.x * normal.z * weight; q.xw = normal.x * distance * weight;
+		q.yy = normal.y * normal.y * weight; q.yz = normal.y * normal.z * weight; q.yw = normal.y * distance * weight;
+		q.zz = normal.z * normal.z * weight; q.zw = normal.z * distance * weight;
+		q.ww = distance * distance * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	Quadric& operator+=(const Quadric& other) {
+		xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+		yy += other.yy; yz += other.yz; yw += other.yw;
+		zz += other.zz; zw += other.zw;
+		ww += other.ww;
+		weight += other.weight;
+		return *this;
+	}
+
+	// Weighted sum of squared distances from p to the planes
+	double error(glm::dvec3 p) const {
+		double result = xx * p.x * p.x + yy * p.y * p.y + zz * p.z * p.z + ww
+			+ 2.0 * (xy * p.x * p.y + xz * p.x * p.z + yz * p.y * p.z + xw * p.x + yw * p.y + zw * p.z);
+		return std::max(result, 0.0);
+	}
+};
+
+// Reduces indices towards targetIndexCount triangles' worth of indices by collapsing edges, cheapest first, until the
+// next collapse's error would pass maxError (in mesh units) or nothing more can be collapsed
+// A collapse's error is the area weighted RMS distance from the merged vertex to the planes of the triangles its two
+// ends have gathered, an estimate of how far the surface moved rather than a bound: single points of the simplified
+// surface can be further than that from the original
+// Vertices are only ever merged into other existing vertices, so the result indexes the same vertex array
+// Open borders only collapse along themselves, and nothing collapses that would turn a triangle over or onto its edge
+// Returns the largest such RMS error of any collapse made, as a distance
+inline float simplifyMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, std::size_t targetIndexCount,
+	float maxError, std::vector<unsigned int>& result) {
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+	// Vertices only hold a position, so ones at the same position are merged first to see the real topology
+	std::vector<uint32_t> order(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v) {
+		order[v] = v;
+	}
+	auto positionLess = [&](uint32_t a, uint32_t b) {
+		const glm::vec3& pa = vertices[a];
+		const glm::vec3& pb = vertices[b];
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		if (pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	};
+	std::sort(order.begin(), order.end(), positionLess);
+	std::vector<uint32_t> remap(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+		bool samePosition = i > 0 && vertices[order[i]] == vertices[order[i - 1]];
+		remap[order[i]] = samePosition ? remap[order[i - 1]] : order[i];
+	}
+
+	result.clear();
+	for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+		uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+		if (a != b && b != c && c != a) {
+			result.insert(result.end(), { a, b, c });
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (std::size_t i = 0; i < result.size(); i += 3) {
+		glm::dvec3 a = vertices[result[i]], b = vertices[result[i + 1]], c = vertices[result[i + 2]];
+		glm::dvec3 normal = glm::cross(b - a, c - a);
+		double length = glm::length(normal);
+		if (length == 0.0) {
+			continue;
+		}
+		normal /= length;
+		Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, a), length * 0.5);
+		quadrics[result[i]] += plane;
+		quadrics[result[i + 1]] += plane;
+		quadrics[result[i + 2]] += plane;
+	}
+
+	enum VertexKind : uint8_t { INTERIOR, BORDER, LOCKED };
+	struct Collapse {
+		uint32_t from, to;
+		double cost;
+	};
+	std::vector<uint64_t> edges;
+	std::vector<uint8_t> kinds(vertexCount);
+	std::vector<uint8_t> borderEdges(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double worstCost = 0.0;
+	bool firstPass = true;
+
+	// Each pass finds the collapses worth making with the topology as it stands, then makes as many as it can
+	// without two of them touching the same vertex
+	while (result.size() > targetIndexCount) {
+		// Undirected edges with how many triangles use them: one is a border, more than two isn't a manifold
+		edges.clear();
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			for (int corner = 0; corner < 3; ++corner) {
+				uint64_t a = result[i + corner], b = result[i + (corner + 1) % 3];
+				edges.push_back(a < b ? a << 32 | b : b << 32 | a);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		std::fill(kinds.begin(), kinds.end(), INTERIOR);
+		std::fill(borderEdges.begin(), borderEdges.end(), 0);
+		struct Edge {
+			uint32_t a, b, uses;
+		};
+		std::vector<Edge> uniqueEdges;
+		for (std::size_t i = 0; i < edges.size();) {
+			std::size_t end = i;
+			while (end < edges.size() && edges[end] == edges[i]) {
+				end++;
+			}
+			Edge edge = { static_cast<uint32_t>(edges[i] >> 32), static_cast<uint32_t>(edges[i]), static_cast<uint32_t>(end - i) };
+			uniqueEdges.push_back(edge);
+			if (edge.uses > 2) {
+				kinds[edge.a] = kinds[edge.b] = LOCKED;
+			}
+			else if (edge.uses == 1) {
+				borderEdges[edge.a] = static_cast<uint8_t>(std::min(borderEdges[edge.a] + 1, 255));
+				borderEdges[edge.b] = static_cast<uint8_t>(std::min(borderEdges[edge.b] + 1, 255));
+			}
+			i = end;
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			if (kinds[v] != LOCKED && borderEdges[v] != 0) {
+				// Where borders meet, or a border touches itself, the vertex can't tell which way the border runs
+				kinds[v] = borderEdges[v] == 2 ? BORDER : LOCKED;
+			}
+		}
+
+		// Borders are held in place by a plane through each border edge, standing up from its triangle
+		if (firstPass) {
+			for (std::size_t i = 0; i < result.size(); i += 3) {
+				for (int corner = 0; corner < 3; ++corner) {
+					uint32_t a = result[i + corner], b = result[i + (corner + 1) % 3];
+					uint64_t key = a < b ? static_cast<uint64_t>(a) << 32 | b : static_cast<uint64_t>(b) << 32 | a;
+					auto range = std::equal_range(edges.begin(), edges.end(), key);
+					if (range.second - range.first != 1) {
+						continue;
+					}
+					glm::dvec3 pa = vertices[a], pb = vertices[b], pc = vertices[result[i + (corner + 2) % 3]];
+					glm::dvec3 edgeVector = pb - pa;
+					glm::dvec3 normal = glm::cross(edgeVector, glm::cross(edgeVector, pc - pa));
+					double length = glm::length(normal);
+					if (length == 0.0) {
+						continue;
+					}
+					normal /= length;
+					Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, pa), glm::dot(edgeVector, edgeVector) * 10.0);
+					quadrics[a] += plane;
+					quadrics[b] += plane;
+				}
+			}
+			firstPass = false;
+		}
+
+		// Each edge collapses whichever way is cheaper and allowed, the cost being the mean squared distance
+		// from the merged vertex to the planes both ends have gathered
+		collapses.clear();
+		for (const Edge& edge : uniqueEdges) {
+			Quadric merged = quadrics[edge.a];
+			merged += quadrics[edge.b];
+			double scale = merged.weight > 0.0 ? 1.0 / merged.weight : 0.0;
+			auto allowed = [&](uint32_t from) {
+				return kinds[from] == INTERIOR || (kinds[from] == BORDER && edge.uses == 1);
+			};
+			Collapse best = { 0, 0, -1.0 };
+			if (allowed(edge.a)) {
+				best = { edge.a, edge.b, merged.error(vertices[edge.b]) * scale };
+			}
+			if (allowed(edge.b)) {
+				double cost = merged.error(vertices[edge.a]) * scale;
+				if (best.cost < 0.0 || cost < best.cost) {
+					best = { edge.b, edge.a, cost };
+				}
+			}
+			if (best.cost >= 0.0 && best.cost <= maxCost) {
+				collapses.push_back(best);
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			if (a.cost != b.cost) return a.cost < b.cost;
+			if (a.from != b.from) return a.from < b.from;
+			return a.to < b.to;
+		});
+
+		// Triangles around each vertex
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result) {
+			triangleOffsets[index + 1]++;
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (std::size_t i = 0; i < result.size(); ++i) {
+				vertexTriangles[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::fill(touched.begin(), touched.end(), 0);
+		for (uint32_t v = 0; v < vertexCount; ++v) {
+			collapseRemap[v] = v;
+		}
+		std::size_t triangles = result.size() / 3;
+		const std::size_t targetTriangles = targetIndexCount / 3;
+		std::size_t collapsed = 0;
+		for (const Collapse& collapse : collapses) {
+			if (triangles <= targetTriangles) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+			// The triangles that keep from must still face roughly the same way with it moved onto to
+			glm::vec3 target = vertices[collapse.to];
+			bool flips = false;
+			std::size_t removed = 0;
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; ++t) {
+				const uint32_t* triangle = &result[vertexTriangles[t] * 3];
+				uint32_t corners[3] = { collapseRemap[triangle[0]], collapseRemap[triangle[1]], collapseRemap[triangle[2]] };
+				if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0]) {
+					continue;
+				}
+				int own = corners[0] == collapse.from ? 0 : corners[1] == collapse.from ? 1 : 2;
+				uint32_t next = corners[(own + 1) % 3], previous = corners[(own + 2) % 3];
+				if (next == collapse.to || previous == collapse.to) {
+					removed++;
+					continue;
+				}
+				glm::vec3 pn = vertices[next], pp = vertices[previous];
+				glm::vec3 before = glm::cross(pn - vertices[collapse.from], pp - vertices[collapse.from]);
+				glm::vec3 after = glm::cross(pn - target, pp - target);
+				// Turning most of the way over counts too, that's how slivers standing on edge get made
+				flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+			}
+			if (flips) {
+				continue;
+			}
+			collapseRemap[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			touched[collapse.from] = touched[collapse.to] = 1;
+			triangles -= removed;
+			worstCost = std::max(worstCost, collapse.cost);
+			collapsed++;
+		}
+		if (collapsed == 0) {
+			break;
+		}
+
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = collapseRemap[result[i]], b = collapseRemap[result[i + 1]], c = collapseRemap[result[i + 2]];
+			if (a != b && b != c && c != a) {
+				result[kept++] = a;
+				result[kept++] = b;
+				result[kept++] = c;
+			}
+		}
+		result.resize(kept);
+	}
+	return static_cast<float>(std::sqrt(worstCost));
+}
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,309 @@
+// Meshes.h
+#ifndef MESHES_H
+#define MESHES_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include <Allocators.h>
+#include <MeshSimplifier.h>
+#include <MeshOptimizer.h>
+
+// Handle to a mesh stored in a MeshRegistry
+typedef uint32_t MeshHandle;
+const MeshHandle NO_MESH = UINT32_MAX;
+
+// Level 0 is the mesh as it was registered, the rest come from MeshRegistry::generateLods
+const uint32_t MAX_MESH_LODS = 4;
+
+// One level of detail: a coarser index list over the mesh's own vertices
+struct MeshLod {
+	std::span<const unsigned int> indices;
+	float error; // RMS estimate of how far the surface is from the full mesh (see simplifyMesh), as a fraction of its bounding radius
+};
+
+// Level 0 of a mesh as it sits in a file, already laid out the way the renderer reads it, so it can be uploaded
+// straight from there instead of converted from Mesh::vertices and Mesh::indices (see MeshRegistry::addMeshView)
+// Either part can be missing, whatever is there describes the same vertices and triangles in the same order
+struct GpuMeshSource {
+	const void* positions = nullptr; // three tightly packed floats per vertex
+	const void* indices = nullptr; // Mesh::indices as 16 or 32 bit integers
+	uint32_t indexSize = 0; // bytes per index
+};
+
+// Local space geometry, shared by every GameObject that references it
+// The vertex and index data itself lives in the registry's arena, or wherever it was for MeshRegistry::addMeshView
+// and addBakedMesh
+struct Mesh {
+	std::span<const glm::vec3> vertices;
+	std::span<const unsigned int> indices;
+	glm::vec3 boundsMin; // local space AABB, computed once when the mesh is registered
+	glm::vec3 boundsMax;
+	uint64_t hash;
+	bool box; // every corner of the bounds and nothing else, so collisions can treat it as an oriented box
+	MeshLod lods[MAX_MESH_LODS]; // only drawn by the renderer, collisions and casts use the full mesh
+	uint32_t lodCount;
+	GpuMeshSource gpuSource; // only set for meshes registered with one
+};
+
+// -------------------------------------------
+// Declaration of MeshRegistry class
+// Stores each distinct mesh once, identical geometry always gets the same handle back
+class MeshRegistry {
+public:
+	// Copies the geometry into the arena once, no copy is made if an identical mesh already exists
+	// Meshes are optimized first (see optimizeMesh), so vertex and triangle order can differ from what was passed in
+	MeshHandle addMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices) {
+		// The optimizer is deterministic, so identical input still finds the identical mesh it was turned into before
+		// Anything that isn't a whole triangle list, like the origin's single point, is stored as given
+		MeshOptimizationStats meshStats;
+		if (optimizeMeshes && !indices.empty() && indices.size() % 3 == 0) {
+			meshStats = optimizeMesh(vertices, indices, optimizedVertices, optimizedIndices);
+			vertices = optimizedVertices;
+			indices = optimizedIndices;
+		}
+		uint64_t hash = hashMesh(vertices, indices);
+		MeshHandle existing = findMesh(vertices, indices, hash);
+		if (existing != NO_MESH) {
+			return existing;
+		}
+		optimizationStats += meshStats;
+		MeshHandle handle = storeMesh(std::span<const glm::vec3>(arena.copy(vertices.data(), vertices.size()), vertices.size()),
+			std::span<const unsigned int>(arena.copy(indices.data(), indices.size()), indices.size()), hash);
+		if (generateLodsOnAdd) {
+			generateLods(handle);
+		}
+		return handle;
+	}
+
+	// Registers geometry where it already is, such as inside a memory mapped file, nothing is copied or optimized
+	// Optimizing would mean writing a reordered copy, which is what this avoids, so these meshes draw in the order
+	// they were given and are counted in getOptimizationStats().unoptimized; bake them (BakedMesh.h) to have both
+	// owner is whatever keeps that memory alive, it's held until the registry is cleared, and dropped straight away
+	// if an identical mesh already exists
+	// gpuSource, if it's kept alive by owner too, is uploaded by the renderer in place of vertices and indices, so they
+	// can be converted copies (kept by owner as well) as long as they keep the source's order
+	MeshHandle addMeshView(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, std::shared_ptr<const void> owner,
+		GpuMeshSource gpuSource = {}) {
+		uint64_t hash = hashMesh(vertices, indices);
+		MeshHandle existing = findMesh(vertices, indices, hash);
+		if (existing != NO_MESH) {
+			return existing;
+		}
+		optimizationStats.unoptimized++;
+		keepAlive(std::move(owner));
+		MeshHandle handle = storeMesh(vertices, indices, hash);
+		meshes[handle].gpuSource = gpuSource;
+		if (generateLodsOnAdd) {
+			generateLods(handle);
+		}
+		return handle;
+	}
+
+	// Registers a mesh read back from a baked file (see BakedMesh.h) exactly as it was baked, so its bounds, hash and
+	// levels of detail are trusted rather than computed, and like addMeshView nothing is copied
+	MeshHandle addBakedMesh(const Mesh& baked, std::shared_ptr<const void> owner) {
+		MeshHandle existing = findMesh(baked.vertices, baked.indices, baked.hash);
+		if (existing != NO_MESH) {
+			return existing;
+		}
+		keepAlive(std::move(owner));
+		MeshHandle handle = static_cast<MeshHandle>(meshes.size());
+		meshes.push_back(baked);
+		lookup.emplace(baked.hash, handle);
+		meshesUpdated = true;
+		return handle;
+	}
+
+	// Simplifies the mesh into up to levels coarser versions for the renderer to switch to as it gets smaller on screen
+	// Each level aims for ratio of the triangles in the one before, and levels stop once one's error would pass
+	// maxError (a fraction of the bounding radius) or would save less than a tenth
+	// Errors are simplifyMesh's RMS plane distance estimates, summed over the levels, so maxError limits that estimate
+	// rather than being a hard bound on how far any point of a level is from the full mesh
+	// Runs once per mesh, every object sharing the mesh gets the levels
+	void generateLods(MeshHandle handle, uint32_t levels = MAX_MESH_LODS - 1, float ratio = 0.5f, float maxError = 0.1f) {
+		Mesh& mesh = meshes[handle];
+		float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+		if (mesh.lodCount > 1 || radius == 0.0f) {
+			return;
+		}
+		std::vector<unsigned int> simplified;
+		for (uint32_t level = 1; level <= levels && level < MAX_MESH_LODS; ++level) {
+			std::span<const unsigned int> previous = mesh.lods[level - 1].indices;
+			std::size_t target = static_cast<std::size_t>(previous.size() / 3 * ratio) * 3;
+			// Errors add up, as each level is simplified from the one before
+			float budget = maxError - mesh.lods[level - 1].error;
+			float error = simplifyMesh(mesh.vertices, previous, target, budget * radius, simplified) / radius;
+			if (simplified.empty() || simplified.size() * 10 > previous.size() * 9) {
+				break;
+			}
+			optimizeVertexCache(simplified, mesh.vertices.size());
+			optimizeOverdraw(simplified, mesh.vertices);
+			mesh.lods[level] = { std::span<const unsigned int>(arena.copy(simplified.data(), simplified.size()), simplified.size()),
+				mesh.lods[level - 1].error + error };
+			mesh.lodCount = level + 1;
+		}
+		meshesUpdated |= mesh.lodCount > 1;
+	}
+
+	const Mesh& getMesh(MeshHandle handle) const {
+		return meshes[handle];
+	}
+
+	std::size_t size() const {
+		return meshes.size();
+	}
+
+	// Forgets every mesh and frees all of their data in one go
+	// Any GameObject still holding one of the old handles must be destroyed first
+	void clear() {
+		meshes.clear();
+		lookup.clear();
+		arena.reset();
+		owners.clear();
+		optimizationStats = MeshOptimizationStats();
+		meshesUpdated = true;
+	}
+
+	AllocatorStats getArenaStats() const {
+		return arena.getStats();
+	}
+
+	// On by default, turning it off stores meshes exactly as given, which is mostly useful for comparing
+	void setOptimizeMeshes(bool enabled) {
+		optimizeMeshes = enabled;
+	}
+
+	// Off by default, turning it on runs generateLods with its default settings on every new mesh added with addMesh or
+	// addMeshView, so the renderer has levels to switch between. Identical meshes share one set of levels, and baked
+	// meshes keep the levels they were baked with
+	void setGenerateLods(bool enabled) {
+		generateLodsOnAdd = enabled;
+	}
+
+	// Vertex cache behaviour of every mesh added since the last clear, as given and as stored
+	const MeshOptimizationStats& getOptimizationStats() const {
+		return optimizationStats;
+	}
+
+	// True once after any new mesh has been added, the renderer uses it to know when to re-upload
+	bool haveMeshesUpdated() {
+		if (meshesUpdated) {
+			meshesUpdated = false;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	std::vector<Mesh> meshes;
+	std::unordered_multimap<uint64_t, MeshHandle> lookup;
+	ChunkedArena arena;
+	std::vector<std::shared_ptr<const void>> owners; // keep the memory of meshes added with addMeshView and addBakedMesh alive
+	bool meshesUpdated = false;
+	bool optimizeMeshes = true;
+	bool generateLodsOnAdd = false;
+	MeshOptimizationStats optimizationStats;
+	std::vector<glm::vec3> optimizedVertices; // scratch space for addMesh
+	std::vector<unsigned int> optimizedIndices;
+
+	void keepAlive(std::shared_ptr<const void> owner) {
+		if (owners.empty() || owners.back() != owner) {
+			owners.push_back(std::move(owner));
+		}
+	}
+
+	// Only meshes with a matching hash need a full comparison
+	MeshHandle findMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, uint64_t hash) const {
+		auto range = lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			const Mesh& existing = meshes[it->second];
+			if (std::ranges::equal(existing.vertices, vertices) && std::ranges::equal(existing.indices, indices)) {
+				return it->second;
+			}
+		}
+		return NO_MESH;
+	}
+
+	// The spans are kept as they are, so they have to stay valid until the registry is cleared
+	MeshHandle storeMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices, uint64_t hash) {
+		MeshHandle handle = static_cast<MeshHandle>(meshes.size());
+		Mesh mesh;
+		mesh.vertices = vertices;
+		mesh.indices = indices;
+		mesh.hash = hash;
+		mesh.boundsMin = mesh.boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0];
+		for (const auto& vert : vertices) {
+			mesh.boundsMin = glm::min(mesh.boundsMin, vert);
+			mesh.boundsMax = glm::max(mesh.boundsMax, vert);
+		}
+		mesh.box = isBoxShaped(vertices, mesh.boundsMin, mesh.boundsMax);
+		mesh.lods[0] = { mesh.indices, 0.0f };
+		mesh.lodCount = 1;
+		meshes.push_back(mesh);
+		lookup.emplace(hash, handle);
+		meshesUpdated = true;
+		return handle;
+	}
+
+	// True if each vertex sits on a corner of the bounds and each corner has a vertex
+	static bool isBoxShaped(std::span<const glm::vec3> vertices, glm::vec3 min, glm::vec3 max) {
+		if (vertices.empty()) {
+			return false;
+		}
+		uint32_t cornersFound = 0;
+		for (const auto& vert : vertices) {
+			uint32_t corner = 0;
+			for (int axis = 0; axis < 3; ++axis) {
+				if (vert[axis] == max[axis]) {
+					corner |= 1u << axis;
+				}
+				else if (vert[axis] != min[axis]) {
+					return false;
+				}
+			}
+			cornersFound |= 1u << corner;
+		}
+		// A flat box has min == max on some axis, only the corners with that bit set can be found
+		uint32_t cornersExpected = 0;
+		for (uint32_t corner = 0; corner < 8; ++corner) {
+			bool reachable = true;
+			for (int axis = 0; axis < 3; ++axis) {
+				reachable &= (corner >> axis & 1u) || min[axis] != max[axis];
+			}
+			cornersExpected |= reachable ? 1u << corner : 0u;
+		}
+		return cornersFound == cornersExpected;
+	}
+
+	// FNV-1a over the raw vertex and index bytes
+	static uint64_t hashMesh(std::span<const glm::vec3> vertices, std::span<const unsigned int> indices) {
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, std::size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (std::size_t i = 0; i < size; ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+		for (const auto& vert : vertices) {
+			float components[3] = { vert.x, vert.y, vert.z };
+			hashBytes(components, sizeof(components));
+		}
+		hashBytes(indices.data(), indices.size() * sizeof(unsigned int));
+		return hash;
+	}
+};
+
+// Global like objectTransforms, so GameObjects can resolve their mesh without an ObjectManager
+MeshRegistry meshRegistry;
+
+#endif // MESHES_H
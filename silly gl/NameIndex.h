@@ -0,0 +1,87 @@
+// NameIndex.h
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// Interned string id, equal strings always get the same id
+typedef uint32_t NameId;
+const NameId NO_NAME = UINT32_MAX;
+
+// Lets the lookup tables be searched with a string_view without building a std::string
+struct StringViewHash {
+	using is_transparent = void;
+	std::size_t operator()(std::string_view text) const {
+		return std::hash<std::string_view>{}(text);
+	}
+};
+
+// -------------------------------------------
+// Declaration of NameIndex class
+// Buckets of values keyed by interned name, each bucket is a dense vector
+// Removal swaps the last value of the bucket into the gap, so callers keep each value's bucket position
+template <typename T>
+class NameIndex {
+public:
+	// Returns the id for a name, creating one if the name hasn't been seen before
+	NameId intern(std::string_view name) {
+		auto it = ids.find(name);
+		if (it != ids.end()) {
+			return it->second;
+		}
+		NameId id = static_cast<NameId>(names.size());
+		names.emplace_back(name);
+		ids.emplace(names.back(), id);
+		buckets.emplace_back();
+		return id;
+	}
+
+	// Returns NO_NAME for names that were never interned, without adding them
+	NameId find(std::string_view name) const {
+		auto it = ids.find(name);
+		return it == ids.end() ? NO_NAME : it->second;
+	}
+
+	const std::string& getName(NameId id) const {
+		return names[id];
+	}
+
+	// Adds a value to the bucket and returns its position in that bucket
+	uint32_t add(NameId id, T value) {
+		buckets[id].push_back(value);
+		return static_cast<uint32_t>(buckets[id].size() - 1);
+	}
+
+	// Removes the value at position, returns the value that was moved into its place (or nullptr-like T{} if none)
+	T remove(NameId id, uint32_t position) {
+		std::vector<T>& bucket = buckets[id];
+		bucket[position] = bucket.back();
+		bucket.pop_back();
+		return position < bucket.size() ? bucket[position] : T{};
+	}
+
+	// Values with the given name, valid until the next add or remove
+	std::span<const T> get(NameId id) const {
+		if (id == NO_NAME) {
+			return {};
+		}
+		return std::span<const T>(buckets[id]);
+	}
+
+	std::span<const T> get(std::string_view name) const {
+		return get(find(name));
+	}
+
+private:
+	std::vector<std::string> names;
+	std::unordered_map<std::string, NameId, StringViewHash, std::equal_to<>> ids;
+	std::vector<std::vector<T>> buckets;
+};
+
+#endif // NAMEINDEX_H
@@ -0,0 +1,708 @@
+// Narrowphase.h
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <array>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#include <Broadphase.h>
+#include <TransformKernels.h>
+#include <JobSystem.h>
+
+// Where two shapes touch: normal is unit length and points from the first shape to the second,
+// depth is how far the second has to move along it to separate them, point lies midway through the overlap
+struct ContactInfo {
+	glm::vec3 normal;
+	float depth;
+	glm::vec3 point;
+};
+
+struct Contact {
+	GameObject* first;
+	GameObject* second;
+	ContactInfo info;
+};
+
+// What the narrowphase sees of an object: its local bounds placed by the model matrix,
+// plus the mesh vertices when the mesh isn't simply a box
+struct CollisionShape {
+	glm::mat4 model;
+	glm::vec3 localMin;
+	glm::vec3 localMax;
+	std::span<const glm::vec3> vertices; // empty for a box, otherwise treated as its convex hull
+
+	bool isBox() const {
+		return vertices.empty();
+	}
+};
+
+// A box with its own axes, shear from a non-uniformly scaled parent is ignored
+struct OrientedBox {
+	glm::vec3 centre;
+	glm::vec3 axes[3]; // unit length
+	glm::vec3 halfExtents;
+
+	static OrientedBox fromShape(const CollisionShape& shape) {
+		OrientedBox box;
+		glm::vec3 localCentre = (shape.localMin + shape.localMax) * 0.5f;
+		glm::vec3 localExtent = (shape.localMax - shape.localMin) * 0.5f;
+		box.centre = glm::vec3(shape.model * glm::vec4(localCentre, 1.0f));
+		for (int axis = 0; axis < 3; ++axis) {
+			glm::vec3 column = glm::vec3(shape.model[axis]);
+			float length = glm::length(column);
+			box.axes[axis] = length > 0.0f ? column / length : glm::vec3(axis == 0, axis == 1, axis == 2);
+			box.halfExtents[axis] = localExtent[axis] * length;
+		}
+		return box;
+	}
+
+	// Corner furthest along direction
+	glm::vec3 support(glm::vec3 direction) const {
+		glm::vec3 point = centre;
+		for (int axis = 0; axis < 3; ++axis) {
+			point += axes[axis] * (glm::dot(axes[axis], direction) >= 0.0f ? halfExtents[axis] : -halfExtents[axis]);
+		}
+		return point;
+	}
+};
+
+// -------------------------------------------
+// Separating axis test between oriented boxes, a register's worth of pairs at a time
+// Both boxes of every pair are stored as 30 streams (A centre, A axes, A half extents, then the same for B),
+// and the 15 candidate axes (3 face normals each, 9 edge cross products) are tested in every lane at once
+// For each pair it writes the smallest overlap over all axes (negative when separated), the depth along the
+// best axis and the index of that axis, edges having to beat faces by 5% so resting boxes keep face normals
+struct BoxPairStreams {
+	static const int STREAM_COUNT = 30;
+	std::vector<float> streams[STREAM_COUNT];
+
+	void set(std::size_t pair, const OrientedBox& a, const OrientedBox& b) {
+		const OrientedBox* boxes[2] = { &a, &b };
+		for (int side = 0; side < 2; ++side) {
+			std::vector<float>* base = streams + side * 15;
+			for (int k = 0; k < 3; ++k) {
+				base[k][pair] = boxes[side]->centre[k];
+				base[12 + k][pair] = boxes[side]->halfExtents[k];
+				for (int axis = 0; axis < 3; ++axis) {
+					base[3 + axis * 3 + k][pair] = boxes[side]->axes[axis][k];
+				}
+			}
+		}
+	}
+
+	OrientedBox get(std::size_t pair, int side) const {
+		OrientedBox box;
+		const std::vector<float>* base = streams + side * 15;
+		for (int k = 0; k < 3; ++k) {
+			box.centre[k] = base[k][pair];
+			box.halfExtents[k] = base[12 + k][pair];
+			for (int axis = 0; axis < 3; ++axis) {
+				box.axes[axis][k] = base[3 + axis * 3 + k][pair];
+			}
+		}
+		return box;
+	}
+
+	void resize(std::size_t count) {
+		for (auto& stream : streams) {
+			stream.resize(count);
+		}
+	}
+
+	std::size_t size() const {
+		return streams[0].size();
+	}
+};
+
+template <typename Lanes>
+inline void separatingAxisLanes(const BoxPairStreams& boxes, std::size_t i, float* separation, float* depth, float* axis) {
+	auto load = [&](int stream) {
+		return Lanes::loadLanes(boxes.streams[stream].data() + i);
+	};
+	Lanes aHalf[3], bHalf[3], t[3], R[3][3], absR[3][3];
+	Lanes aAxes[3][3], bAxes[3][3], centreOffset[3];
+	for (int k = 0; k < 3; ++k) {
+		aHalf[k] = load(12 + k);
+		bHalf[k] = load(27 + k);
+		centreOffset[k] = load(15 + k) - load(k);
+		for (int n = 0; n < 3; ++n) {
+			aAxes[n][k] = load(3 + n * 3 + k);
+			bAxes[n][k] = load(18 + n * 3 + k);
+		}
+	}
+	// Everything is expressed in A's frame, the epsilon stops near parallel edges producing a zero axis that passes
+	Lanes epsilon = Lanes::broadcast(1e-6f);
+	for (int n = 0; n < 3; ++n) {
+		t[n] = centreOffset[0] * aAxes[n][0] + centreOffset[1] * aAxes[n][1] + centreOffset[2] * aAxes[n][2];
+		for (int m = 0; m < 3; ++m) {
+			R[n][m] = aAxes[n][0] * bAxes[m][0] + aAxes[n][1] * bAxes[m][1] + aAxes[n][2] * bAxes[m][2];
+			absR[n][m] = R[n][m].abs() + epsilon;
+		}
+	}
+
+	Lanes huge = Lanes::broadcast(FLT_MAX);
+	Lanes minOverlap = huge, bestScore = huge, bestDepth = huge, bestAxis = Lanes::broadcast(0.0f);
+	auto consider = [&](Lanes overlap, Lanes axisDepth, Lanes score, float index) {
+		minOverlap = minOverlap.min(overlap);
+		Lanes better = score < bestScore;
+		bestScore = Lanes::select(better, score, bestScore);
+		bestDepth = Lanes::select(better, axisDepth, bestDepth);
+		bestAxis = Lanes::select(better, Lanes::broadcast(index), bestAxis);
+	};
+
+	for (int n = 0; n < 3; ++n) {
+		Lanes overlap = aHalf[n] + bHalf[0] * absR[n][0] + bHalf[1] * absR[n][1] + bHalf[2] * absR[n][2] - t[n].abs();
+		consider(overlap, overlap, overlap, static_cast<float>(n));
+	}
+	for (int m = 0; m < 3; ++m) {
+		Lanes distance = (t[0] * R[0][m] + t[1] * R[1][m] + t[2] * R[2][m]).abs();
+		Lanes overlap = aHalf[0] * absR[0][m] + aHalf[1] * absR[1][m] + aHalf[2] * absR[2][m] + bHalf[m] - distance;
+		consider(overlap, overlap, overlap, static_cast<float>(3 + m));
+	}
+	Lanes one = Lanes::broadcast(1.0f), zero = Lanes::broadcast(0.0f), minLength = Lanes::broadcast(1e-3f), edgeBias = Lanes::broadcast(1.05f);
+	for (int n = 0; n < 3; ++n) {
+		int n1 = (n + 1) % 3, n2 = (n + 2) % 3;
+		for (int m = 0; m < 3; ++m) {
+			int m1 = (m + 1) % 3, m2 = (m + 2) % 3;
+			Lanes ra = aHalf[n1] * absR[n2][m] + aHalf[n2] * absR[n1][m];
+			Lanes rb = bHalf[m1] * absR[n][m2] + bHalf[m2] * absR[n][m1];
+			Lanes overlap = ra + rb - (t[n2] * R[n1][m] - t[n1] * R[n2][m]).abs();
+			// The cross product isn't unit length, so the overlap is scaled to get a real distance
+			// Edges within a twentieth of a degree of parallel only count towards separation, their cross product is noise
+			Lanes length = (one - R[n][m] * R[n][m]).max(zero).sqrt();
+			Lanes axisDepth = overlap / length.max(minLength);
+			Lanes score = Lanes::select(length < minLength, huge, axisDepth * edgeBias);
+			consider(overlap, axisDepth, score, static_cast<float>(6 + n * 3 + m));
+		}
+	}
+	minOverlap.storeLanes(separation + i);
+	bestDepth.storeLanes(depth + i);
+	bestAxis.storeLanes(axis + i);
+}
+
+// Runs the test over pairs [first, last) of the streams, results are indexed by pair
+inline void separatingAxisBatch(const BoxPairStreams& boxes, std::size_t first, std::size_t last, float* separation, float* depth, float* axis) {
+	std::size_t i = first;
+	for (; i + FloatLanes::width <= last; i += FloatLanes::width) {
+		separatingAxisLanes<FloatLanes>(boxes, i, separation, depth, axis);
+	}
+	for (; i < last; ++i) {
+		separatingAxisLanes<ScalarLanes>(boxes, i, separation, depth, axis);
+	}
+}
+
+// Turns a best axis index back into the contact, the normal flipped to point from a to b
+inline ContactInfo boxContact(const OrientedBox& a, const OrientedBox& b, float depth, int axis) {
+	glm::vec3 normal;
+	if (axis < 3) {
+		normal = a.axes[axis];
+	}
+	else if (axis < 6) {
+		normal = b.axes[axis - 3];
+	}
+	else {
+		normal = glm::cross(a.axes[(axis - 6) / 3], b.axes[(axis - 6) % 3]);
+		float length = glm::length(normal);
+		normal = length > 1e-6f ? normal / length : a.axes[(axis - 6) / 3];
+	}
+	if (glm::dot(normal, b.centre - a.centre) < 0.0f) {
+		normal = -normal;
+	}
+	// b's deepest corner, moved back halfway out of a
+	glm::vec3 point = b.support(-normal) + normal * (depth * 0.5f);
+	return { normal, depth, point };
+}
+
+// Single pair version of the batch, touching boxes count as colliding like the AABB test
+inline bool collideBoxes(const OrientedBox& a, const OrientedBox& b, ContactInfo& contact) {
+	BoxPairStreams pair;
+	pair.resize(1);
+	pair.set(0, a, b);
+	float separation, depth, axis;
+	separatingAxisLanes<ScalarLanes>(pair, 0, &separation, &depth, &axis);
+	if (separation < 0.0f) {
+		return false;
+	}
+	contact = boxContact(a, b, depth, static_cast<int>(axis));
+	return true;
+}
+
+// -------------------------------------------
+// GJK and EPA between two convex shapes
+// GJK walks a simplex of points of the Minkowski difference a - b towards the origin, and the shapes overlap
+// if the simplex ends up enclosing it; EPA then grows that simplex into a polytope until its face nearest the
+// origin lies on the surface of a - b, which gives the penetration normal and depth
+class ConvexCollider {
+public:
+	ConvexCollider(const CollisionShape& first, const CollisionShape& second) : a(first), b(second) {
+		if (a.isBox()) {
+			boxA = OrientedBox::fromShape(a);
+		}
+		if (b.isBox()) {
+			boxB = OrientedBox::fromShape(b);
+		}
+	}
+
+	bool collide(ContactInfo& contact) {
+		glm::vec3 centreA = glm::vec3(a.model * glm::vec4((a.localMin + a.localMax) * 0.5f, 1.0f));
+		glm::vec3 centreB = glm::vec3(b.model * glm::vec4((b.localMin + b.localMax) * 0.5f, 1.0f));
+		glm::vec3 direction = centreA - centreB;
+		if (glm::dot(direction, direction) < 1e-12f) {
+			direction = glm::vec3(1.0f, 0.0f, 0.0f);
+		}
+		// Used when the shapes only just touch and there's no volume for EPA to work with
+		glm::vec3 fallbackNormal = -glm::normalize(direction);
+
+		simplex[0] = support(direction);
+		simplexSize = 1;
+		direction = -simplex[0].w;
+		for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+			// The origin lies on the simplex, so the shapes overlap, but EPA still needs a tetrahedron around it
+			if (glm::dot(direction, direction) < 1e-12f) {
+				if (!completeSimplex() || !expandPolytope(contact)) {
+					contact = { fallbackNormal, 0.0f, simplex[0].a };
+				}
+				return true;
+			}
+			SupportPoint point = support(direction);
+			if (glm::dot(point.w, direction) < 0.0f) {
+				return false;
+			}
+			simplex[simplexSize++] = point;
+			if (nextSimplex(direction)) {
+				if (!expandPolytope(contact)) {
+					contact = { fallbackNormal, 0.0f, simplex[0].a };
+				}
+				return true;
+			}
+		}
+		// Out of iterations without finding a separating direction, which happens when the origin sits exactly
+		// on a face of the simplex (symmetric overlaps like two shapes sharing a centre), so EPA decides the depth
+		if (!completeSimplex() || !expandPolytope(contact)) {
+			contact = { fallbackNormal, 0.0f, simplex[0].a };
+		}
+		return true;
+	}
+
+private:
+	static const int MAX_ITERATIONS = 64;
+
+	// A point of a - b, along with the points of a and b it came from
+	struct SupportPoint {
+		glm::vec3 w;
+		glm::vec3 a;
+		glm::vec3 b;
+	};
+
+	const CollisionShape& a;
+	const CollisionShape& b;
+	OrientedBox boxA, boxB;
+	SupportPoint simplex[4];
+	int simplexSize = 0;
+
+	static glm::vec3 supportOf(const CollisionShape& shape, const OrientedBox& box, glm::vec3 direction) {
+		if (shape.isBox()) {
+			return box.support(direction);
+		}
+		// Searching in local space keeps the vertices untouched, only the winner is transformed
+		glm::vec3 localDirection = glm::transpose(glm::mat3(shape.model)) * direction;
+		const glm::vec3* best = &shape.vertices[0];
+		float bestDot = glm::dot(*best, localDirection);
+		for (const auto& vertex : shape.vertices) {
+			float value = glm::dot(vertex, localDirection);
+			if (value > bestDot) {
+				bestDot = value;
+				best = &vertex;
+			}
+		}
+		return glm::vec3(shape.model * glm::vec4(*best, 1.0f));
+	}
+
+	SupportPoint support(glm::vec3 direction) const {
+		SupportPoint point;
+		point.a = supportOf(a, boxA, direction);
+		point.b = supportOf(b, boxB, -direction);
+		point.w = point.a - point.b;
+		return point;
+	}
+
+	static bool sameDirection(glm::vec3 direction, glm::vec3 towards) {
+		return glm::dot(direction, towards) > 0.0f;
+	}
+
+	// Reduces the simplex to the feature nearest the origin and points direction at the origin from it
+	// The newest point is always last, returns true once a tetrahedron contains the origin
+	bool nextSimplex(glm::vec3& direction) {
+		switch (simplexSize) {
+		case 2:
+			return line(direction);
+		case 3:
+			return triangle(direction);
+		default:
+			return tetrahedron(direction);
+		}
+	}
+
+	bool line(glm::vec3& direction) {
+		SupportPoint p1 = simplex[1], p0 = simplex[0];
+		glm::vec3 toOther = p0.w - p1.w, toOrigin = -p1.w;
+		if (sameDirection(toOther, toOrigin)) {
+			direction = glm::cross(glm::cross(toOther, toOrigin), toOther);
+			// The origin lies on the line itself
+			if (glm::dot(direction, direction) < 1e-12f) {
+				glm::vec3 axis = std::fabs(toOther.x) < 0.57f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+				direction = glm::cross(toOther, axis);
+			}
+		}
+		else {
+			simplex[0] = p1;
+			simplexSize = 1;
+			direction = toOrigin;
+		}
+		return false;
+	}
+
+	bool triangle(glm::vec3& direction) {
+		SupportPoint p2 = simplex[2], p1 = simplex[1], p0 = simplex[0];
+		glm::vec3 ab = p1.w - p2.w, ac = p0.w - p2.w, toOrigin = -p2.w;
+		glm::vec3 normal = glm::cross(ab, ac);
+		if (sameDirection(glm::cross(normal, ac), toOrigin)) {
+			if (sameDirection(ac, toOrigin)) {
+				simplex[0] = p0;
+				simplex[1] = p2;
+				simplexSize = 2;
+				direction = glm::cross(glm::cross(ac, toOrigin), ac);
+				return false;
+			}
+			simplex[0] = p1;
+			simplex[1] = p2;
+			simplexSize = 2;
+			return line(direction);
+		}
+		if (sameDirection(glm::cross(ab, normal), toOrigin)) {
+			simplex[0] = p1;
+			simplex[1] = p2;
+			simplexSize = 2;
+			return line(direction);
+		}
+		if (sameDirection(normal, toOrigin)) {
+			direction = normal;
+		}
+		else {
+			// Keeps the triangle wound so its normal faces the origin
+			simplex[0] = p1;
+			simplex[1] = p0;
+			direction = -normal;
+		}
+		return false;
+	}
+
+	bool tetrahedron(glm::vec3& direction) {
+		SupportPoint p3 = simplex[3], p2 = simplex[2], p1 = simplex[1], p0 = simplex[0];
+		glm::vec3 ab = p2.w - p3.w, ac = p1.w - p3.w, ad = p0.w - p3.w, toOrigin = -p3.w;
+		glm::vec3 abc = glm::cross(ab, ac), acd = glm::cross(ac, ad), adb = glm::cross(ad, ab);
+		if (sameDirection(abc, toOrigin)) {
+			simplex[0] = p1;
+			simplex[1] = p2;
+			simplex[2] = p3;
+			simplexSize = 3;
+			return triangle(direction);
+		}
+		if (sameDirection(acd, toOrigin)) {
+			simplex[0] = p0;
+			simplex[1] = p1;
+			simplex[2] = p3;
+			simplexSize = 3;
+			return triangle(direction);
+		}
+		if (sameDirection(adb, toOrigin)) {
+			simplex[0] = p2;
+			simplex[1] = p0;
+			simplex[2] = p3;
+			simplexSize = 3;
+			return triangle(direction);
+		}
+		return true;
+	}
+
+	// Adds support points until the simplex is a tetrahedron with some volume, false if the shapes are too flat for one
+	bool completeSimplex() {
+		static const glm::vec3 axes[6] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+		};
+		const float epsilon = 1e-6f;
+		if (simplexSize == 1) {
+			for (const auto& direction : axes) {
+				SupportPoint point = support(direction);
+				if (glm::length(point.w - simplex[0].w) > epsilon) {
+					simplex[simplexSize++] = point;
+					break;
+				}
+			}
+		}
+		if (simplexSize == 2) {
+			glm::vec3 line = simplex[1].w - simplex[0].w;
+			glm::vec3 axis = std::fabs(line.x) < std::fabs(line.y) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::vec3 across = glm::cross(line, axis);
+			for (glm::vec3 direction : { across, -across, glm::cross(line, across), -glm::cross(line, across) }) {
+				SupportPoint point = support(direction);
+				if (glm::length(glm::cross(point.w - simplex[0].w, line)) > epsilon * glm::length(line)) {
+					simplex[simplexSize++] = point;
+					break;
+				}
+			}
+		}
+		if (simplexSize == 3) {
+			glm::vec3 normal = glm::cross(simplex[1].w - simplex[0].w, simplex[2].w - simplex[0].w);
+			for (glm::vec3 direction : { normal, -normal }) {
+				SupportPoint point = support(direction);
+				if (std::fabs(glm::dot(point.w - simplex[0].w, normal)) > epsilon * glm::length(normal)) {
+					simplex[simplexSize++] = point;
+					break;
+				}
+			}
+		}
+		return simplexSize == 4;
+	}
+
+	struct Face {
+		uint32_t vertex[3];
+		glm::vec3 normal; // unit length, facing away from the origin
+		float distance; // from the origin to the face's plane
+	};
+
+	// Builds a face over three polytope vertices, false if they are too close to a line to give a normal
+	// The polytope stays convex, so facing away from a point inside it is facing outwards
+	static bool makeFace(const std::vector<SupportPoint>& vertices, uint32_t v0, uint32_t v1, uint32_t v2, glm::vec3 inside, Face& face) {
+		glm::vec3 normal = glm::cross(vertices[v1].w - vertices[v0].w, vertices[v2].w - vertices[v0].w);
+		float length = glm::length(normal);
+		if (length < 1e-10f) {
+			return false;
+		}
+		normal /= length;
+		if (glm::dot(normal, vertices[v0].w - inside) < 0.0f) {
+			face = { { v0, v2, v1 }, -normal, -glm::dot(normal, vertices[v0].w) };
+		}
+		else {
+			face = { { v0, v1, v2 }, normal, glm::dot(normal, vertices[v0].w) };
+		}
+		return true;
+	}
+
+	bool expandPolytope(ContactInfo& contact) {
+		std::vector<SupportPoint> vertices(simplex, simplex + 4);
+		glm::vec3 inside = (vertices[0].w + vertices[1].w + vertices[2].w + vertices[3].w) * 0.25f;
+		std::vector<Face> faces;
+		static const uint32_t start[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+		for (const auto& indices : start) {
+			Face face;
+			if (!makeFace(vertices, indices[0], indices[1], indices[2], inside, face)) {
+				return false;
+			}
+			faces.push_back(face);
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>> horizon;
+		for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+			std::size_t nearest = 0;
+			for (std::size_t i = 1; i < faces.size(); ++i) {
+				if (faces[i].distance < faces[nearest].distance) {
+					nearest = i;
+				}
+			}
+			Face closest = faces[nearest];
+			SupportPoint point = support(closest.normal);
+			if (glm::dot(point.w, closest.normal) - closest.distance < 1e-4f || iteration == MAX_ITERATIONS - 1) {
+				contact = faceContact(vertices, closest);
+				return true;
+			}
+
+			// Every face the new point can see is removed, and the edges left open are joined to it
+			horizon.clear();
+			for (std::size_t i = 0; i < faces.size();) {
+				if (glm::dot(faces[i].normal, point.w - vertices[faces[i].vertex[0]].w) > 0.0f) {
+					for (int edge = 0; edge < 3; ++edge) {
+						std::pair<uint32_t, uint32_t> current(faces[i].vertex[edge], faces[i].vertex[(edge + 1) % 3]);
+						auto shared = std::find(horizon.begin(), horizon.end(), std::make_pair(current.second, current.first));
+						if (shared != horizon.end()) {
+							*shared = horizon.back();
+							horizon.pop_back();
+						}
+						else {
+							horizon.push_back(current);
+						}
+					}
+					faces[i] = faces.back();
+					faces.pop_back();
+				}
+				else {
+					++i;
+				}
+			}
+			uint32_t newVertex = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(point);
+			for (const auto& edge : horizon) {
+				Face face;
+				if (makeFace(vertices, edge.first, edge.second, newVertex, inside, face)) {
+					faces.push_back(face);
+				}
+			}
+			if (faces.empty()) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	// The origin projected onto the face, as a blend of the face's points on a and on b
+	static ContactInfo faceContact(const std::vector<SupportPoint>& vertices, const Face& face) {
+		const SupportPoint& p0 = vertices[face.vertex[0]];
+		const SupportPoint& p1 = vertices[face.vertex[1]];
+		const SupportPoint& p2 = vertices[face.vertex[2]];
+		glm::vec3 projected = face.normal * face.distance;
+		glm::vec3 v0 = p1.w - p0.w, v1 = p2.w - p0.w, v2 = projected - p0.w;
+		float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+		float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+		float denominator = d00 * d11 - d01 * d01;
+		float u = 1.0f / 3.0f, v = 1.0f / 3.0f;
+		if (std::fabs(denominator) > 1e-12f) {
+			u = (d11 * d20 - d01 * d21) / denominator;
+			v = (d00 * d21 - d01 * d20) / denominator;
+		}
+		float w = 1.0f - u - v;
+		glm::vec3 pointA = p0.a * w + p1.a * u + p2.a * v;
+		glm::vec3 pointB = p0.b * w + p1.b * u + p2.b * v;
+		return { face.normal, face.distance, (pointA + pointB) * 0.5f };
+	}
+};
+
+// Boxes go through the separating axis test, anything else (or a box against anything else) through GJK and EPA
+inline bool collideShapes(const CollisionShape& a, const CollisionShape& b, ContactInfo& contact) {
+	if (a.isBox() && b.isBox()) {
+		return collideBoxes(OrientedBox::fromShape(a), OrientedBox::fromShape(b), contact);
+	}
+	return ConvexCollider(a, b).collide(contact);
+}
+
+// Counts from the last Narrowphase::update
+struct NarrowphaseStats {
+	std::size_t pairsTested = 0;
+	std::size_t boxPairs = 0; // went through the batched separating axis test
+	std::size_t convexPairs = 0; // went through GJK and EPA
+	std::size_t contacts = 0;
+};
+
+// -------------------------------------------
+// Declaration of Narrowphase class
+// Takes the pairs a broadphase found and keeps the ones whose shapes really touch
+// Box pairs are gathered into structure-of-arrays streams and tested a register at a time, the rest run
+// GJK and EPA one pair at a time, and both are split across the job system when one is given
+class Narrowphase {
+public:
+	// shapeOf(object, shape) fills in an object's shape and returns false for objects without one, their pairs are dropped
+	// Contacts come out in the order of pairs, with the pair's objects in the same order
+	template <typename ShapeOf>
+	const std::vector<Contact>& update(std::span<const CollisionPair> pairs, ShapeOf shapeOf, JobSystem* jobs = nullptr) {
+		contacts.clear();
+		boxStreams.resize(pairs.size());
+		boxPairs.clear();
+		convexPairs.clear();
+		convexShapes.clear();
+
+		CollisionShape first, second;
+		for (uint32_t i = 0; i < pairs.size(); ++i) {
+			if (!shapeOf(pairs[i].first, first) || !shapeOf(pairs[i].second, second)) {
+				continue;
+			}
+			if (first.isBox() && second.isBox()) {
+				boxStreams.set(boxPairs.size(), OrientedBox::fromShape(first), OrientedBox::fromShape(second));
+				boxPairs.push_back(i);
+			}
+			else {
+				convexShapes.push_back(first);
+				convexShapes.push_back(second);
+				convexPairs.push_back(i);
+			}
+		}
+
+		boxStreams.resize(boxPairs.size());
+		separation.resize(boxPairs.size());
+		depth.resize(boxPairs.size());
+		axis.resize(boxPairs.size());
+		auto boxRange = [this](std::size_t first, std::size_t last) {
+			separatingAxisBatch(boxStreams, first, last, separation.data(), depth.data(), axis.data());
+		};
+		convexResults.resize(convexPairs.size());
+		convexHits.resize(convexPairs.size());
+		auto convexRange = [this](std::size_t first, std::size_t last) {
+			for (std::size_t i = first; i < last; ++i) {
+				convexHits[i] = ConvexCollider(convexShapes[i * 2], convexShapes[i * 2 + 1]).collide(convexResults[i]);
+			}
+		};
+		if (jobs) {
+			jobs->parallelFor(0, boxPairs.size(), 1024, boxRange);
+			jobs->parallelFor(0, convexPairs.size(), 16, convexRange);
+		}
+		else {
+			boxRange(0, boxPairs.size());
+			convexRange(0, convexPairs.size());
+		}
+
+		// Merged back into pair order, only touching pairs need their normal worked out
+		std::size_t nextBox = 0, nextConvex = 0;
+		while (nextBox < boxPairs.size() || nextConvex < convexPairs.size()) {
+			if (nextConvex == convexPairs.size() || (nextBox < boxPairs.size() && boxPairs[nextBox] < convexPairs[nextConvex])) {
+				if (separation[nextBox] >= 0.0f) {
+					const CollisionPair& pair = pairs[boxPairs[nextBox]];
+					OrientedBox a = boxStreams.get(nextBox, 0), b = boxStreams.get(nextBox, 1);
+					contacts.push_back({ pair.first, pair.second, boxContact(a, b, depth[nextBox], static_cast<int>(axis[nextBox])) });
+				}
+				nextBox++;
+			}
+			else {
+				if (convexHits[nextConvex]) {
+					const CollisionPair& pair = pairs[convexPairs[nextConvex]];
+					contacts.push_back({ pair.first, pair.second, convexResults[nextConvex] });
+				}
+				nextConvex++;
+			}
+		}
+
+		stats.pairsTested = pairs.size();
+		stats.boxPairs = boxPairs.size();
+		stats.convexPairs = convexPairs.size();
+		stats.contacts = contacts.size();
+		return contacts;
+	}
+
+	const std::vector<Contact>& getContacts() const {
+		return contacts;
+	}
+
+	NarrowphaseStats getStats() const {
+		return stats;
+	}
+
+private:
+	std::vector<Contact> contacts;
+	BoxPairStreams boxStreams;
+	std::vector<uint32_t> boxPairs; // index into the pairs of each box pair in the streams
+	std::vector<float> separation, depth, axis;
+	std::vector<uint32_t> convexPairs;
+	std::vector<CollisionShape> convexShapes; // two per convex pair
+	std::vector<ContactInfo> convexResults;
+	std::vector<uint8_t> convexHits;
+	NarrowphaseStats stats;
+};
+
+#endif // NARROWPHASE_H
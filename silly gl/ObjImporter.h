@@ -0,0 +1,406 @@
+// ObjImporter.h
+#ifndef OBJIMPORTER_H
+#define OBJIMPORTER_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <span>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#include <MappedFile.h>
+#include <JobSystem.h>
+
+// What the last ObjImporter::load or parse read
+struct ObjImportStats {
+	std::size_t bytes = 0;
+	std::size_t lines = 0;
+	std::size_t vertices = 0;
+	std::size_t faces = 0;
+	std::size_t triangles = 0; // faces with more than three corners are split into fans
+	std::size_t chunks = 0; // pieces of the file parsed in parallel
+	double milliseconds = 0.0; // mapping and parsing, not counting anything done with the mesh afterwards
+};
+
+// Parsers for the numbers in OBJ text, they never look at the locale, and leave text pointing just past the number
+// Nan and infinity aren't accepted
+
+inline bool parseObjInt(const char*& text, const char* end, int64_t& value) {
+	const char* p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	const char* digits = p;
+	uint64_t magnitude = 0;
+	while (p < end && static_cast<unsigned>(*p - '0') < 10 && magnitude < (uint64_t(1) << 40)) {
+		magnitude = magnitude * 10 + static_cast<unsigned>(*p - '0');
+		++p;
+	}
+	if (p == digits) {
+		return false;
+	}
+	value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+	text = p;
+	return true;
+}
+
+inline bool parseObjFloat(const char*& text, const char* end, float& value) {
+	static const double powersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char* p = text;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	// Up to 19 significant digits fit in the mantissa, any more only move the decimal point
+	uint64_t mantissa = 0;
+	int significant = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	while (p < end && static_cast<unsigned>(*p - '0') < 10) {
+		if (significant < 19) {
+			mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+			significant += mantissa != 0;
+		}
+		else {
+			exponent++;
+		}
+		anyDigits = true;
+		++p;
+	}
+	if (p < end && *p == '.') {
+		++p;
+		while (p < end && static_cast<unsigned>(*p - '0') < 10) {
+			if (significant < 19) {
+				mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+				significant += mantissa != 0;
+				exponent--;
+			}
+			anyDigits = true;
+			++p;
+		}
+	}
+	if (!anyDigits) {
+		return false;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* exponentText = p + 1;
+		int64_t written;
+		if (parseObjInt(exponentText, end, written)) {
+			exponent += static_cast<int>(std::clamp<int64_t>(written, -100000, 100000));
+			p = exponentText;
+		}
+	}
+	// Both the mantissa and the power of ten are exact doubles on the fast path, so one multiply or divide rounds
+	// correctly, anything else is still far more precise than the float it ends up in, and overflows to infinity
+	double result;
+	if (mantissa == 0) {
+		result = 0.0;
+	}
+	else if (mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+		result = exponent < 0 ? static_cast<double>(mantissa) / powersOfTen[-exponent] : static_cast<double>(mantissa) * powersOfTen[exponent];
+	}
+	else {
+		result = static_cast<double>(mantissa) * std::pow(10.0, exponent);
+	}
+	value = static_cast<float>(negative ? -result : result);
+	text = p;
+	return true;
+}
+
+// -------------------------------------------
+// Declaration of ObjImporter class
+// Reads the triangles of a Wavefront OBJ file, only positions and faces are used, everything else is skipped
+// The file is memory mapped and split into chunks at line breaks, which are parsed in parallel in two passes: the
+// first counts each chunk's vertices and triangles, the second writes them straight into their final place in the
+// output, so nothing is parsed into a temporary and copied afterwards
+// Every object and group in the file ends up in the one mesh
+class ObjImporter {
+public:
+	// Chunk size is a trade off between spreading work over threads and the cost of each chunk's bookkeeping
+	explicit ObjImporter(std::size_t chunkSize = std::size_t(1) << 20) : chunkSize(std::max<std::size_t>(chunkSize, 64)) {
+	}
+
+	// Replaces the vertices and indices with the file's, false with getError set if it can't be read or isn't valid
+	bool load(const std::string& path, JobSystem* jobs = nullptr) {
+		auto start = std::chrono::steady_clock::now();
+		MappedFile file;
+		if (!file.open(path)) {
+			stats = ObjImportStats();
+			clearMesh();
+			error = "can't open " + path;
+			return false;
+		}
+		bool ok = parse(std::span<const char>(reinterpret_cast<const char*>(file.data()), file.size()), jobs);
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!ok) {
+			error = path + ":" + error;
+		}
+		return ok;
+	}
+
+	// The same as load, for OBJ text that's already in memory
+	bool parse(std::span<const char> text, JobSystem* jobs = nullptr) {
+		auto start = std::chrono::steady_clock::now();
+		stats = ObjImportStats();
+		stats.bytes = text.size();
+		error.clear();
+		splitChunks(text);
+		stats.chunks = chunks.size();
+
+		auto countRange = [&](std::size_t first, std::size_t last) {
+			for (std::size_t chunk = first; chunk < last; ++chunk) {
+				countChunk(chunks[chunk]);
+			}
+		};
+		if (jobs) {
+			jobs->parallelFor(0, chunks.size(), 1, countRange);
+		}
+		else {
+			countRange(0, chunks.size());
+		}
+
+		// Each chunk's share of the output starts where the chunks before it end
+		std::size_t vertexCount = 0;
+		std::size_t triangleCount = 0;
+		std::size_t lineCount = 0;
+		for (Chunk& chunk : chunks) {
+			chunk.firstVertex = vertexCount;
+			chunk.firstTriangle = triangleCount;
+			chunk.firstLine = lineCount;
+			vertexCount += chunk.vertices;
+			triangleCount += chunk.triangles;
+			lineCount += chunk.lines;
+			stats.faces += chunk.faces;
+		}
+		stats.vertices = vertexCount;
+		stats.triangles = triangleCount;
+		stats.lines = lineCount;
+		if (vertexCount > UINT32_MAX) {
+			clearMesh();
+			error = "more vertices than 32 bit indices can address";
+			return false;
+		}
+		vertices.resize(vertexCount);
+		indices.resize(triangleCount * 3);
+
+		auto parseRange = [&](std::size_t first, std::size_t last) {
+			for (std::size_t chunk = first; chunk < last; ++chunk) {
+				parseChunk(chunks[chunk], vertexCount);
+			}
+		};
+		if (jobs) {
+			jobs->parallelFor(0, chunks.size(), 1, parseRange);
+		}
+		else {
+			parseRange(0, chunks.size());
+		}
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// The first chunk with a problem has the first one in the file
+		for (const Chunk& chunk : chunks) {
+			if (chunk.errorLine != 0) {
+				error = std::to_string(chunk.errorLine) + ": " + chunk.error;
+				clearMesh();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const std::vector<glm::vec3>& getVertices() const {
+		return vertices;
+	}
+
+	const std::vector<unsigned int>& getIndices() const {
+		return indices;
+	}
+
+	const ObjImportStats& getStats() const {
+		return stats;
+	}
+
+	// Where and why the last load or parse failed, as "line: reason"
+	const std::string& getError() const {
+		return error;
+	}
+
+private:
+	// A run of whole lines, parsed by one thread
+	struct Chunk {
+		const char* begin;
+		const char* end;
+		std::size_t vertices = 0;
+		std::size_t faces = 0;
+		std::size_t triangles = 0;
+		std::size_t lines = 0;
+		std::size_t firstVertex = 0;
+		std::size_t firstTriangle = 0;
+		std::size_t firstLine = 0;
+		std::size_t errorLine = 0; // 1 based, 0 if the chunk parsed cleanly
+		const char* error = nullptr;
+	};
+
+	std::size_t chunkSize;
+	std::vector<Chunk> chunks;
+	std::vector<glm::vec3> vertices;
+	std::vector<unsigned int> indices;
+	ObjImportStats stats;
+	std::string error;
+
+	void clearMesh() {
+		vertices.clear();
+		indices.clear();
+	}
+
+	static bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	static const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	static const char* skipToken(const char* p, const char* end) {
+		while (p < end && !isSpace(*p) && *p != '\n') {
+			++p;
+		}
+		return p;
+	}
+
+	static const char* nextLine(const char* p, const char* end) {
+		while (p < end && *p != '\n') {
+			++p;
+		}
+		return p < end ? p + 1 : end;
+	}
+
+	// Which kind of line p starts, moving p past the keyword, only vertex positions and faces matter
+	enum class LineKind { Other, Vertex, Face };
+
+	static LineKind lineKind(const char*& p, const char* end) {
+		p = skipSpaces(p, end);
+		if (end - p >= 2 && isSpace(p[1])) {
+			if (p[0] == 'v') {
+				p += 2;
+				return LineKind::Vertex;
+			}
+			if (p[0] == 'f') {
+				p += 2;
+				return LineKind::Face;
+			}
+		}
+		return LineKind::Other;
+	}
+
+	// Chunks end just after a line break, so no line is split between two of them
+	void splitChunks(std::span<const char> text) {
+		chunks.clear();
+		const char* p = text.data();
+		const char* end = text.data() + text.size();
+		while (p < end) {
+			Chunk chunk;
+			chunk.begin = p;
+			p = static_cast<std::size_t>(end - p) > chunkSize ? nextLine(p + chunkSize - 1, end) : end;
+			chunk.end = p;
+			chunks.push_back(chunk);
+		}
+	}
+
+	static void countChunk(Chunk& chunk) {
+		const char* p = chunk.begin;
+		while (p < chunk.end) {
+			chunk.lines++;
+			LineKind kind = lineKind(p, chunk.end);
+			if (kind == LineKind::Vertex) {
+				chunk.vertices++;
+			}
+			else if (kind == LineKind::Face) {
+				std::size_t corners = 0;
+				for (p = skipSpaces(p, chunk.end); p < chunk.end && *p != '\n'; p = skipSpaces(p, chunk.end)) {
+					p = skipToken(p, chunk.end);
+					corners++;
+				}
+				chunk.faces++;
+				chunk.triangles += corners >= 3 ? corners - 2 : 0;
+			}
+			p = nextLine(p, chunk.end);
+		}
+	}
+
+	void parseChunk(Chunk& chunk, std::size_t vertexCount) {
+		glm::vec3* vertexOut = vertices.data() + chunk.firstVertex;
+		unsigned int* indexOut = indices.data() + chunk.firstTriangle * 3;
+		// Negative indices count back from the last vertex read so far, in this chunk or the ones before
+		std::size_t verticesSoFar = chunk.firstVertex;
+		std::size_t line = chunk.firstLine;
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+		auto fail = [&](const char* reason) {
+			chunk.errorLine = line;
+			chunk.error = reason;
+		};
+		while (p < end) {
+			line++;
+			LineKind kind = lineKind(p, end);
+			if (kind == LineKind::Vertex) {
+				// Any w or colour after the position is ignored
+				glm::vec3 position;
+				for (int axis = 0; axis < 3; ++axis) {
+					p = skipSpaces(p, end);
+					if (!parseObjFloat(p, end, position[axis])) {
+						return fail("vertex needs three numbers");
+					}
+				}
+				*vertexOut++ = position;
+				verticesSoFar++;
+			}
+			else if (kind == LineKind::Face) {
+				// Texture coordinate and normal indices after a slash are skipped, the face is split into a fan
+				unsigned int firstCorner = 0;
+				unsigned int previousCorner = 0;
+				std::size_t corners = 0;
+				for (p = skipSpaces(p, end); p < end && *p != '\n'; p = skipSpaces(p, end)) {
+					int64_t written;
+					if (!parseObjInt(p, end, written) || written == 0) {
+						return fail("face corner isn't a vertex index");
+					}
+					int64_t index = written > 0 ? written - 1 : static_cast<int64_t>(verticesSoFar) + written;
+					if (index < 0 || index >= static_cast<int64_t>(vertexCount)) {
+						return fail("face refers to a vertex that doesn't exist");
+					}
+					p = skipToken(p, end);
+					unsigned int corner = static_cast<unsigned int>(index);
+					if (corners == 0) {
+						firstCorner = corner;
+					}
+					else if (corners >= 2) {
+						indexOut[0] = firstCorner;
+						indexOut[1] = previousCorner;
+						indexOut[2] = corner;
+						indexOut += 3;
+					}
+					previousCorner = corner;
+					corners++;
+				}
+			}
+			p = nextLine(p, end);
+		}
+	}
+};
+
+#endif
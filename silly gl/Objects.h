@@ -12,102 +12,632 @@
 #include <vector>
 #include <string>
 #include <functional>
-#include <algorithm> // Include this for std::remove
+#include <algorithm>
+#include <iostream>
 
 #include <useful.h>
 
-// Has to be a global variable, as it is accessed in both classes
-bool objectsUpdated = true;
+#include <SoA.h>
+#include <Allocators.h>
+#include <Meshes.h>
+#include <NameIndex.h>
+#include <Broadphase.h>
+#include <SpatialHash.h>
+#include <AABBTree.h>
+#include <OverlapBatch.h>
+#include <JobSystem.h>
+#include <TransformKernels.h>
+#include <Hierarchy.h>
+#include <Narrowphase.h>
+#include <RayCast.h>
+#include <ObjImporter.h>
+#include <GltfLoader.h>
+#include <BakedMesh.h>
+
+class GameObject;
+
+const uint32_t NO_INSTANCE = UINT32_MAX;
+
+// An instance slot the renderer gave a destroyed object, see ObjectManager::getReleasedInstances
+struct ReleasedInstance {
+	MeshHandle mesh;
+	uint32_t instance;
+};
+
+// Handle to an object owned by an ObjectManager
+// Destroying the object bumps the generation stored in the manager, so old handles stop resolving instead of dangling
+struct ObjectHandle {
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const ObjectHandle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+	bool operator!=(const ObjectHandle& other) const {
+		return !(*this == other);
+	}
+};
+
+// -------------------------------------------
+// Declaration of TransformStorage class
+// Positions, rotations, scales and bounds of every GameObject, stored as structure-of-arrays
+// Each object owns one dense slot; destroying an object moves the last slot into its place
+// Positions, rotations and scales are local to the parent when an object has one, models then hold the world matrix
+class TransformStorage {
+public:
+	SoAVec3 positions;
+	SoAQuat rotations;
+	SoAVec3 scales;
+	SoAVec3 boundsMin; // cached world space AABB, recomputed when boundsDirty is set
+	SoAVec3 boundsMax;
+	std::vector<uint8_t> boundsDirty;
+	std::vector<uint8_t> broadphaseDirty; // moved since the ObjectManager last updated its broadphase
+	bool anyBroadphaseDirty = false; // set along with any broadphaseDirty flag, so queries can skip the scan
+	AlignedVector<glm::mat4> models; // cached position * rotation * scale, rebuilt when modelDirty is set
+	std::vector<uint8_t> modelDirty;
+	std::vector<GameObject*> owners; // owners[slot] is the object viewing that slot
+	TransformHierarchy hierarchy; // parent links between slots
+	// Slots the renderer has to look at again, each listed once until the renderer clears the list
+	std::vector<uint32_t> renderDirtySlots;
+	std::vector<uint32_t> renderListIndex; // position in renderDirtySlots, NOT_LISTED if the slot is clean
+	static constexpr uint32_t NOT_LISTED = UINT32_MAX;
+
+	uint32_t allocate(GameObject* owner, glm::vec3 position) {
+		uint32_t slot = static_cast<uint32_t>(owners.size());
+		positions.push(position);
+		rotations.push(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		scales.push(glm::vec3(1.0f, 1.0f, 1.0f));
+		boundsMin.push(position);
+		boundsMax.push(position);
+		boundsDirty.push_back(1);
+		broadphaseDirty.push_back(1);
+		anyBroadphaseDirty = true;
+		models.push_back(glm::mat4(1.0f));
+		modelDirty.push_back(1);
+		owners.push_back(owner);
+		hierarchy.addSlot();
+		renderListIndex.push_back(NOT_LISTED);
+		markRenderDirty(slot);
+		return slot;
+	}
+
+	void markRenderDirty(uint32_t slot) {
+		if (renderListIndex[slot] == NOT_LISTED) {
+			renderListIndex[slot] = static_cast<uint32_t>(renderDirtySlots.size());
+			renderDirtySlots.push_back(slot);
+		}
+	}
+
+	// Called by the renderer once it has handled every listed slot
+	void clearRenderDirty() {
+		for (uint32_t slot : renderDirtySlots) {
+			renderListIndex[slot] = NOT_LISTED;
+		}
+		renderDirtySlots.clear();
+	}
+
+	// Any transform change invalidates the model matrix, the cached bounds and the broadphase proxy
+	void markDirty(uint32_t slot) {
+		modelDirty[slot] = 1;
+		boundsDirty[slot] = 1;
+		broadphaseDirty[slot] = 1;
+		anyBroadphaseDirty = true;
+		hierarchy.markDirty(slot);
+		markRenderDirty(slot);
+	}
+
+	// Moves child under parent, or makes it a root with NO_SLOT, keeping its local transform
+	void setParent(uint32_t child, uint32_t parent) {
+		hierarchy.detach(child);
+		if (parent != NO_SLOT) {
+			hierarchy.attach(child, parent);
+		}
+		markDirty(child);
+	}
+
+	// Brings every world matrix in the hierarchy up to date, cheap when nothing in it moved
+	void updateHierarchy() {
+		if (hierarchy.needsUpdate()) {
+			hierarchy.update(positions, rotations, scales, models, [this](uint32_t slot) {
+				modelDirty[slot] = 0;
+				boundsDirty[slot] = 1;
+				broadphaseDirty[slot] = 1;
+				anyBroadphaseDirty = true;
+				markRenderDirty(slot);
+			});
+		}
+	}
+
+	// Defined after GameObject, as it has to repoint the object whose slot gets moved
+	void release(uint32_t slot);
+
+	void reserve(std::size_t count) {
+		positions.reserve(count);
+		rotations.reserve(count);
+		scales.reserve(count);
+		boundsMin.reserve(count);
+		boundsMax.reserve(count);
+		boundsDirty.reserve(count);
+		broadphaseDirty.reserve(count);
+		models.reserve(count);
+		modelDirty.reserve(count);
+		owners.reserve(count);
+		renderListIndex.reserve(count);
+	}
+
+	std::size_t size() const {
+		return owners.size();
+	}
+};
+
+// Global as GameObjects can exist before being added to an ObjectManager
+TransformStorage objectTransforms;
+
+// Every GameObject is allocated from this pool (see GameObject::operator new), so spawning doesn't hit malloc
+ObjectPool<GameObject> gameObjectPool;
 
 // -------------------------------------------
 // Declaration of GameObject class
+// Transform data lives in objectTransforms, the object itself only remembers its slot
+// Geometry is a handle into meshRegistry in local space, the model matrix places it in the world
+// name is indexed by the ObjectManager, so rename managed objects through ObjectManager::renameObject
 class GameObject {
 public:
-	glm::vec3 position;
-	glm::vec3 rotation;
-	std::vector<glm::vec3> vertices;
 	std::string name;
-	std::vector<unsigned int> indices;
+	MeshHandle mesh;
 
-	GameObject(glm::vec3 pos, std::string handle)
-		: position(pos), name(handle), rotation(glm::vec3(0.0f, 0.0f, 0.0f)), vertices({}), indices({}) {};
+	GameObject(glm::vec3 pos, std::string handle, MeshHandle meshHandle = NO_MESH)
+		: name(handle), mesh(meshHandle) {
+		slot = objectTransforms.allocate(this, pos);
+	};
 
-	void move(glm::vec3 change) {
-		position += change;
-		for (auto& vert : vertices) {
-			vert += change;
+	~GameObject() {
+		objectTransforms.release(slot);
+	}
+
+	// Copying would make two objects view the same slot
+	GameObject(const GameObject&) = delete;
+	GameObject& operator=(const GameObject&) = delete;
+
+	// `new GameObject(...)` takes a slot from gameObjectPool, anything derived from GameObject uses the normal heap
+	static void* operator new(std::size_t size) {
+		return size == sizeof(GameObject) ? gameObjectPool.allocate() : ::operator new(size);
+	}
+
+	static void operator delete(void* pointer, std::size_t size) {
+		if (size == sizeof(GameObject)) {
+			gameObjectPool.deallocate(pointer);
+		}
+		else {
+			::operator delete(pointer);
 		}
-		objectsUpdated = true;
 	}
 
-	//faster operation for rotating vertices of an object using simd
-	void rotate(glm::mat4 rotationMatrix) {
-		for (auto& vert : vertices) {
-			glm::vec3 translated = vert - position;
-			glm::vec4 simd_translated = glm::vec4(translated, 1.0f);
-			glm::vec4 simd_result = rotationMatrix * simd_translated;
-			vert = glm::vec3(simd_result) + position;
+	uint32_t getSlot() const {
+		return slot;
+	}
+
+	// Handle given out by the ObjectManager this object was added to, safe to keep across frames
+	ObjectHandle getHandle() const {
+		return handle;
+	}
+
+	// Static objects are expected to stay put, see ObjectManager::setStatic
+	bool isStatic() const {
+		return staticObject;
+	}
+
+	// Occluders are drawn into the renderer's occlusion buffer, see ObjectManager::setOccluder
+	bool isOccluder() const {
+		return occluder;
+	}
+
+	std::span<const glm::vec3> getVertices() const {
+		return mesh == NO_MESH ? std::span<const glm::vec3>() : meshRegistry.getMesh(mesh).vertices;
+	}
+
+	std::span<const unsigned int> getIndices() const {
+		return mesh == NO_MESH ? std::span<const unsigned int>() : meshRegistry.getMesh(mesh).indices;
+	}
+
+	// The renderer moves the object to the new mesh's instances when it next drains the dirty list
+	void setMesh(MeshHandle meshHandle) {
+		mesh = meshHandle;
+		markTransformDirty();
+	}
+
+	glm::vec3 getPosition() const {
+		return objectTransforms.positions.get(slot);
+	}
+
+	glm::quat getRotation() const {
+		return objectTransforms.rotations.get(slot);
+	}
+
+	glm::vec3 getScale() const {
+		return objectTransforms.scales.get(slot);
+	}
+
+	void setPosition(glm::vec3 position) {
+		objectTransforms.positions.set(slot, position);
+		markTransformDirty();
+	}
+
+	void setRotation(glm::quat rotation) {
+		objectTransforms.rotations.set(slot, rotation);
+		markTransformDirty();
+	}
+
+	void setScale(glm::vec3 scale) {
+		objectTransforms.scales.set(slot, scale);
+		markTransformDirty();
+	}
+
+	// Rebuilds the model matrix only if the transform changed since it was last asked for
+	// Objects in a hierarchy get their world matrix, brought up to date along with the rest of the hierarchy
+	const glm::mat4& getModelMatrix() const {
+		if (objectTransforms.hierarchy.isInHierarchy(slot)) {
+			objectTransforms.updateHierarchy();
 		}
+		else if (objectTransforms.modelDirty[slot]) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), getPosition());
+			model *= glm::mat4_cast(getRotation());
+			model = glm::scale(model, getScale());
+			objectTransforms.models[slot] = model;
+			objectTransforms.modelDirty[slot] = 0;
+		}
+		return objectTransforms.models[slot];
 	}
 
+	// Parent in the transform hierarchy, null for a root, set through ObjectManager::setParent
+	GameObject* getParent() const {
+		uint32_t parent = objectTransforms.hierarchy.getParent(slot);
+		return parent == NO_SLOT ? nullptr : objectTransforms.owners[parent];
+	}
 
-    void scaleInPlace(glm::vec3 scale) {
-		for (auto& vert : vertices) {
-			vert -= position;
-			vert *= scale;
-			vert += position;
+	std::vector<GameObject*> getChildren() const {
+		std::vector<GameObject*> children;
+		for (uint32_t child = objectTransforms.hierarchy.getFirstChild(slot); child != NO_SLOT; child = objectTransforms.hierarchy.getNextSibling(child)) {
+			children.push_back(objectTransforms.owners[child]);
 		}
-		objectsUpdated = true;
+		return children;
+	}
+
+	// getPosition is relative to the parent, this is where the object ends up in the world
+	glm::vec3 getWorldPosition() const {
+		return glm::vec3(getModelMatrix()[3]);
+	}
+
+	void move(glm::vec3 change) {
+		setPosition(getPosition() + change);
+	}
+
+	// Rotates the object about its own position
+	void rotate(glm::mat4 rotationMatrix) {
+		setRotation(glm::normalize(glm::quat_cast(glm::mat3(rotationMatrix)) * getRotation()));
+	}
+
+	// Scales the object about its own position, along its local axes
+    void scaleInPlace(glm::vec3 scale) {
+		setScale(getScale() * scale);
     }
 
+	// Scales the object about the world origin, so its position is scaled too
 	void scale(glm::vec3 scale) {
-		position *= scale;
-		for (auto& vert : vertices) {
-			vert *= scale;
+		setPosition(getPosition() * scale);
+		setScale(getScale() * scale);
+	}
+
+	// Recomputes the world space AABB by transforming the mesh's local box (Arvo's method)
+	// O(1) regardless of vertex count, the result is cached in the bounds arrays
+	void updateAABB() const {
+		glm::vec3 min, max;
+		if (mesh == NO_MESH) {
+			min = max = objectTransforms.hierarchy.isInHierarchy(slot) ? getWorldPosition() : getPosition();
+		}
+		else {
+			const Mesh& local = meshRegistry.getMesh(mesh);
+			const glm::mat4& model = getModelMatrix();
+			glm::vec3 centre = (local.boundsMin + local.boundsMax) * 0.5f;
+			glm::vec3 extent = (local.boundsMax - local.boundsMin) * 0.5f;
+			glm::vec3 worldCentre = glm::vec3(model * glm::vec4(centre, 1.0f));
+			glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(model[0])), glm::abs(glm::vec3(model[1])), glm::abs(glm::vec3(model[2])));
+			glm::vec3 worldExtent = absolute * extent;
+			min = worldCentre - worldExtent;
+			max = worldCentre + worldExtent;
 		}
-		objectsUpdated = true;
+		objectTransforms.boundsMin.set(slot, min);
+		objectTransforms.boundsMax.set(slot, max);
+		objectTransforms.boundsDirty[slot] = 0;
 	}
 
 	// Function to get the AABB of the GameObject
 	// Given a min and max vector, it will set the min and max of the AABB
+	// Only recomputed if the object has been transformed since the last call, shared by everything that needs bounds
 	void getAABB(glm::vec3& min, glm::vec3& max) const {
-		if (vertices.empty()) {
-			min = max = position;
-			return;
+		if (objectTransforms.hierarchy.isInHierarchy(slot)) {
+			objectTransforms.updateHierarchy();
+		}
+		if (objectTransforms.boundsDirty[slot]) {
+			updateAABB();
+		}
+		min = objectTransforms.boundsMin.get(slot);
+		max = objectTransforms.boundsMax.get(slot);
+	}
+
+	// True if the object was given this tag through ObjectManager::addTag
+	bool hasTag(NameId tag) const {
+		for (const auto& entry : tags) {
+			if (entry.id == tag) {
+				return true;
+			}
 		}
-		min = max = vertices[0];
-		for (const auto& vert : vertices) {
-			min = glm::min(min, vert);
-			max = glm::max(max, vert);
+		return false;
+	}
+
+private:
+	friend class TransformStorage;
+	friend class ObjectManager;
+	uint32_t slot;
+
+	// Where this object sits in the ObjectManager's name and tag buckets
+	struct IndexEntry {
+		NameId id;
+		uint32_t position;
+	};
+	void markTransformDirty() {
+		objectTransforms.markDirty(slot);
+	}
+
+	IndexEntry nameEntry = { NO_NAME, 0 };
+	std::vector<IndexEntry> tags;
+
+	ObjectHandle handle;
+	uint32_t managedIndex = UINT32_MAX; // position in the ObjectManager's dense object list
+	uint32_t broadphaseProxy = NO_PROXY;
+	bool staticObject = false;
+	bool occluder = false;
+
+	// Where the renderer has filed the object, which can lag behind mesh until the renderer catches up
+	friend class Renderer;
+	MeshHandle renderMesh = NO_MESH;
+	uint32_t renderInstance = NO_INSTANCE;
+	uint32_t renderLod = 0; // level of detail drawn last frame, kept so switching has some hysteresis
+};
+
+void TransformStorage::release(uint32_t slot) {
+	// Children are left where they are as roots, their local transform becoming their world one
+	for (uint32_t child = hierarchy.getFirstChild(slot); child != NO_SLOT; child = hierarchy.getFirstChild(slot)) {
+		setParent(child, NO_SLOT);
+	}
+	hierarchy.detach(slot);
+	uint32_t last = static_cast<uint32_t>(owners.size() - 1);
+	positions.swapRemove(slot);
+	rotations.swapRemove(slot);
+	scales.swapRemove(slot);
+	boundsMin.swapRemove(slot);
+	boundsMax.swapRemove(slot);
+	boundsDirty[slot] = boundsDirty[last];
+	boundsDirty.pop_back();
+	broadphaseDirty[slot] = broadphaseDirty[last];
+	broadphaseDirty.pop_back();
+	models[slot] = models[last];
+	models.pop_back();
+	modelDirty[slot] = modelDirty[last];
+	modelDirty.pop_back();
+	owners[slot] = owners[last];
+	owners.pop_back();
+	hierarchy.moveSlot(last, slot);
+	// The list holds slots, so the freed one is taken out and the moved one renamed
+	uint32_t listed = renderListIndex[slot];
+	if (listed != NOT_LISTED) {
+		uint32_t lastListed = renderDirtySlots.back();
+		renderDirtySlots[listed] = lastListed;
+		renderListIndex[lastListed] = listed;
+		renderDirtySlots.pop_back();
+		renderListIndex[slot] = NOT_LISTED;
+	}
+	if (slot != last) {
+		listed = renderListIndex[last];
+		if (listed != NOT_LISTED) {
+			renderDirtySlots[listed] = slot;
 		}
+		renderListIndex[slot] = listed;
 	}
+	renderListIndex.pop_back();
+	if (slot != last) {
+		owners[slot]->slot = slot;
+	}
+}
+
+// Structure used for finding collision pairs and answering region queries, switchable at runtime
+enum class BroadphaseType {
+	SweepAndPrune,
+	SpatialHash,
+	AABBTree
 };
 
 // Declaration of ObjectManager class
+// Owns every object added to it, destroyObject frees them
 class ObjectManager {
 public:
 	ObjectManager() {
-		GameObject* origin = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), "origin");
-		origin->vertices = {glm::vec3(0.0f, 0.0f, 0.0f)};
-		origin->indices = {0};
-		objects.push_back(origin);
+		addOrigin();
 	}
 
-	void setObjectsUpdated(bool updated) {
-		objectsUpdated = updated;
+	~ObjectManager() {
+		for (auto object : objects) {
+			delete object;
+		}
 	}
 
-	void addObject(GameObject* object) {
+	ObjectManager(const ObjectManager&) = delete;
+	ObjectManager& operator=(const ObjectManager&) = delete;
+
+	// Bulk passes such as updateBounds are split across this pool when one is set
+	void setJobSystem(JobSystem* jobs) {
+		jobSystem = jobs;
+	}
+
+	// Takes ownership of the object and returns a handle to it
+	ObjectHandle addObject(GameObject* object) {
+		// Reuse a freed handle index if there is one, its generation was already bumped on destroy
+		uint32_t index;
+		if (freeHandle != UINT32_MAX) {
+			index = freeHandle;
+			freeHandle = handles[index].nextFree;
+		}
+		else {
+			index = static_cast<uint32_t>(handles.size());
+			handles.push_back({ nullptr, 0, UINT32_MAX });
+		}
+		handles[index].object = object;
+		object->handle = { index, handles[index].generation };
+
+		object->managedIndex = static_cast<uint32_t>(objects.size());
 		objects.push_back(object);
-		objectsUpdated = true;
+		NameId id = nameIndex.intern(object->name);
+		object->nameEntry = { id, nameIndex.add(id, object) };
+
+		glm::vec3 min, max;
+		object->getAABB(min, max);
+		object->broadphaseProxy = createProxy(object, min, max);
+		objectTransforms.broadphaseDirty[object->getSlot()] = 0;
+
+		// Picked up by the renderer's next pass over the dirty list
+		objectTransforms.markRenderDirty(object->getSlot());
+		return object->handle;
+	}
+
+	// Returns the object a handle refers to, or nullptr if it has been destroyed
+	GameObject* getObject(ObjectHandle handle) const {
+		if (handle.index >= handles.size() || handles[handle.index].generation != handle.generation) {
+			return nullptr;
+		}
+		return handles[handle.index].object;
+	}
+
+	bool isAlive(ObjectHandle handle) const {
+		return getObject(handle) != nullptr;
 	}
 
+	void destroyObject(ObjectHandle handle) {
+		GameObject* object = getObject(handle);
+		if (object) {
+			destroyObject(object);
+		}
+	}
+
+	// O(1): the last object is swapped into the gap and the handle goes on the free list
+	// The object is deleted, so any raw pointers to it are dangling afterwards, hold ObjectHandles instead
+	// Children are destroyed with it, any not owned by this manager are left behind as roots
 	void destroyObject(GameObject* object) {
-		objects.erase(std::remove(objects.begin(), objects.end(), object), objects.end());
-		objectsUpdated = true;
+		for (uint32_t child = objectTransforms.hierarchy.getFirstChild(object->slot); child != NO_SLOT;
+			child = objectTransforms.hierarchy.getFirstChild(object->slot)) {
+			GameObject* childObject = objectTransforms.owners[child];
+			if (getObject(childObject->handle) == childObject) {
+				destroyObject(childObject);
+			}
+			else {
+				objectTransforms.setParent(child, NO_SLOT);
+			}
+		}
+		uint32_t index = object->managedIndex;
+		objects[index] = objects.back();
+		objects[index]->managedIndex = index;
+		objects.pop_back();
+
+		HandleEntry& entry = handles[object->handle.index];
+		entry.object = nullptr;
+		entry.generation++;
+		entry.nextFree = freeHandle;
+		freeHandle = object->handle.index;
+
+		destroyProxy(object);
+		if (object->occluder) {
+			occluders.erase(std::find(occluders.begin(), occluders.end(), object));
+		}
+		unindexName(object);
+		for (const auto& tag : object->tags) {
+			GameObject* moved = tagIndex.remove(tag.id, tag.position);
+			if (moved) {
+				for (auto& entry : moved->tags) {
+					if (entry.id == tag.id) {
+						entry.position = tag.position;
+					}
+				}
+			}
+		}
+		object->tags.clear();
+		if (object->renderInstance != NO_INSTANCE) {
+			releasedInstances.push_back({ object->renderMesh, object->renderInstance });
+		}
+		delete object;
 	}
 
+	// Attaches child under parent, or makes it a root again with a null parent
+	// The child's position, rotation and scale are kept and from then on are relative to the parent
+	// Returns false without changing anything if child would end up as its own ancestor
+	bool setParent(GameObject* child, GameObject* parent) {
+		if (!parent) {
+			objectTransforms.setParent(child->slot, NO_SLOT);
+			return true;
+		}
+		if (parent == child || objectTransforms.hierarchy.isAncestor(child->slot, parent->slot)) {
+			return false;
+		}
+		objectTransforms.setParent(child->slot, parent->slot);
+		return true;
+	}
+
+	void renameObject(GameObject* object, std::string_view name) {
+		unindexName(object);
+		object->name = name;
+		NameId id = nameIndex.intern(object->name);
+		object->nameEntry = { id, nameIndex.add(id, object) };
+	}
+
+	// Tags are interned like names, an object can have any number of them
+	void addTag(GameObject* object, std::string_view tag) {
+		NameId id = tagIndex.intern(tag);
+		if (!object->hasTag(id)) {
+			object->tags.push_back({ id, tagIndex.add(id, object) });
+		}
+	}
+
+	void removeTag(GameObject* object, std::string_view tag) {
+		NameId id = tagIndex.find(tag);
+		for (size_t i = 0; i < object->tags.size(); ++i) {
+			if (object->tags[i].id == id) {
+				GameObject* moved = tagIndex.remove(id, object->tags[i].position);
+				if (moved) {
+					for (auto& entry : moved->tags) {
+						if (entry.id == id) {
+							entry.position = object->tags[i].position;
+						}
+					}
+				}
+				object->tags[i] = object->tags.back();
+				object->tags.pop_back();
+				return;
+			}
+		}
+	}
+
+	// Id of a tag, so per frame checks can use GameObject::hasTag without string compares
+	NameId getTagId(std::string_view tag) {
+		return tagIndex.intern(tag);
+	}
+
+	// AABBs first, then the objects' real shapes, so rotated cubes that only overlap as AABBs don't collide
+	// Objects without a mesh only have their AABB to go on
 	bool checkCollision(GameObject* object1, GameObject* object2) {
+		ContactInfo contact;
+		return checkCollision(object1, object2, contact);
+	}
+
+	// The same test, also giving the contact normal (from object1 to object2), depth and point when they collide
+	bool checkCollision(GameObject* object1, GameObject* object2, ContactInfo& contact) {
 		glm::vec3 min1, max1, min2, max2;
 		object1->getAABB(min1, max1);
 		object2->getAABB(min2, max2);
@@ -117,95 +647,762 @@ public:
 		bool collisionY = (min1.y <= max2.y && max1.y >= min2.y);
 		bool collisionZ = (min1.z <= max2.z && max1.z >= min2.z);
 
-		return collisionX && collisionY && collisionZ;
+		if (!(collisionX && collisionY && collisionZ)) {
+			return false;
+		}
+		CollisionShape shape1, shape2;
+		if (!getCollisionShape(object1, shape1) || !getCollisionShape(object2, shape2)) {
+			// The AABBs are the shapes, so like SAT the normal is the axis of least overlap, pointing from object1 to object2
+			glm::vec3 overlap = glm::min(max1, max2) - glm::max(min1, min2);
+			int axis = overlap.x < overlap.y ? (overlap.x < overlap.z ? 0 : 2) : (overlap.y < overlap.z ? 1 : 2);
+			glm::vec3 normal(0.0f);
+			normal[axis] = (min2[axis] + max2[axis]) >= (min1[axis] + max1[axis]) ? 1.0f : -1.0f;
+			contact = { normal, overlap[axis], (glm::max(min1, min2) + glm::min(max1, max2)) * 0.5f };
+			return true;
+		}
+		return collideShapes(shape1, shape2, contact);
+	}
+
+	// Every pair of objects whose AABBs overlap, found with the selected broadphase
+	const std::vector<CollisionPair>& findCollisionPairs() {
+		syncBroadphase();
+		switch (broadphaseType) {
+		case BroadphaseType::SpatialHash:
+			return spatialHash.update();
+		case BroadphaseType::AABBTree:
+			return aabbTree.update();
+		default:
+			return broadphase.update();
+		}
 	}
-	// Gets object by its handle name
-	// If multiple objects have the same name, it only returns the first one to be created
-	GameObject* getObjectByName(std::string name) {
-		for (auto& object : objects) {
-			if (object->name == name) {
-				return object;
+
+	// Broadphase pairs whose shapes really touch, with a contact for each
+	// Pairs of objects without a mesh are dropped, the list is reused by the next call
+	const std::vector<Contact>& findContacts() {
+		updateModelMatrices();
+		const std::vector<CollisionPair>& pairs = findCollisionPairs();
+		return narrowphase.update(pairs, getCollisionShape, jobSystem);
+	}
+
+	NarrowphaseStats getNarrowphaseStats() const {
+		return narrowphase.getStats();
+	}
+
+	// Switching rebuilds the newly selected structure from every object, the old one is emptied
+	void setBroadphase(BroadphaseType type) {
+		if (type == broadphaseType) {
+			return;
+		}
+		broadphase.clear();
+		spatialHash.clear();
+		aabbTree.clear();
+		broadphaseType = type;
+		for (auto object : objects) {
+			glm::vec3 min, max;
+			object->getAABB(min, max);
+			object->broadphaseProxy = createProxy(object, min, max);
+			objectTransforms.broadphaseDirty[object->getSlot()] = 0;
+		}
+	}
+
+	BroadphaseType getBroadphase() const {
+		return broadphaseType;
+	}
+
+	// Marks an object as static level geometry, only the AABB tree treats static objects differently:
+	// they go into a separate tree that is never refit, and pairs between two static objects aren't reported
+	void setStatic(GameObject* object, bool isStatic) {
+		if (object->staticObject == isStatic) {
+			return;
+		}
+		object->staticObject = isStatic;
+		if (broadphaseType == BroadphaseType::AABBTree) {
+			destroyProxy(object);
+			glm::vec3 min, max;
+			object->getAABB(min, max);
+			object->broadphaseProxy = createProxy(object, min, max);
+			objectTransforms.broadphaseDirty[object->getSlot()] = 0;
+		}
+	}
+
+	// Occluders are big, simple objects like walls and terrain that hide others when occlusion culling is on
+	// Keep the set small, they're rasterized on one thread every frame
+	void setOccluder(GameObject* object, bool isOccluder) {
+		if (object->occluder == isOccluder) {
+			return;
+		}
+		object->occluder = isOccluder;
+		if (isOccluder) {
+			occluders.push_back(object);
+		}
+		else {
+			occluders.erase(std::find(occluders.begin(), occluders.end(), object));
+		}
+	}
+
+	std::span<GameObject* const> getOccluders() const {
+		return occluders;
+	}
+
+	// Changing the cell size rebuilds the grid, it works best around the size of a typical object
+	// A size that isn't positive and finite is rejected and the grid is left as it was
+	bool setSpatialHashCellSize(float cellSize) {
+		if (!SpatialHash::isValidCellSize(cellSize)) {
+			std::cout << "ERROR::BROADPHASE::INVALID_CELL_SIZE: " << cellSize << std::endl;
+			return false;
+		}
+		spatialHash = SpatialHash(cellSize);
+		if (broadphaseType == BroadphaseType::SpatialHash) {
+			broadphaseType = BroadphaseType::SweepAndPrune;
+			setBroadphase(BroadphaseType::SpatialHash);
+		}
+		return true;
+	}
+
+	// Objects whose AABB overlaps the region, appended to results
+	// Uses the grid or the AABB tree when one is selected, otherwise a batched SIMD pass over the cached bounds
+	void queryRegion(glm::vec3 min, glm::vec3 max, std::vector<GameObject*>& results) {
+		syncBroadphase();
+		if (broadphaseType == BroadphaseType::SpatialHash) {
+			spatialHash.queryRegion(min, max, results);
+			return;
+		}
+		if (broadphaseType == BroadphaseType::AABBTree) {
+			aabbTree.queryRegion(min, max, results);
+			return;
+		}
+		for (uint32_t slot : findOverlappingSlots(min, max)) {
+			results.push_back(objectTransforms.owners[slot]);
+		}
+	}
+
+	// Objects whose AABB comes within radius of centre, appended to results
+	void queryRadius(glm::vec3 centre, float radius, std::vector<GameObject*>& results) {
+		syncBroadphase();
+		if (broadphaseType == BroadphaseType::SpatialHash) {
+			spatialHash.queryRadius(centre, radius, results);
+			return;
+		}
+		if (broadphaseType == BroadphaseType::AABBTree) {
+			aabbTree.queryRadius(centre, radius, results);
+			return;
+		}
+		// Only boxes touching the sphere's bounding box need the exact distance test
+		for (uint32_t slot : findOverlappingSlots(centre - radius, centre + radius)) {
+			GameObject* object = objectTransforms.owners[slot];
+			glm::vec3 objectMin = objectTransforms.boundsMin.get(slot);
+			glm::vec3 objectMax = objectTransforms.boundsMax.get(slot);
+			glm::vec3 offset = glm::clamp(centre, objectMin, objectMax) - centre;
+			if (glm::dot(offset, offset) <= radius * radius) {
+				results.push_back(object);
 			}
 		}
-		return nullptr;
 	}
 
-	// Gets all objects with the given name
-	std::vector<GameObject*> getObjectListByName(std::string name) {
-		std::vector<GameObject*> objectsWithName = {};
-		for (auto& object : objects) {
-			if (object->name == name) {
-				objectsWithName.push_back(object);
+	// Objects whose AABB the ray hits within maxDistance, appended to results in no particular order
+	void queryRay(glm::vec3 origin, glm::vec3 direction, float maxDistance, std::vector<GameObject*>& results) {
+		syncBroadphase();
+		if (broadphaseType == BroadphaseType::AABBTree) {
+			aabbTree.queryRay(origin, direction, maxDistance, [&](GameObject* object, float) {
+				results.push_back(object);
+				return maxDistance;
+			});
+			return;
+		}
+		glm::vec3 inverseDirection = 1.0f / direction;
+		for (auto object : objects) {
+			glm::vec3 objectMin, objectMax;
+			object->getAABB(objectMin, objectMax);
+			if (rayIntersectsAABB(origin, inverseDirection, maxDistance, objectMin, objectMax) >= 0.0f) {
+				results.push_back(object);
 			}
 		}
-		return objectsWithName;
+	}
+
+	// Closest object the ray hits, tested against its mesh's triangles
+	// Objects whose mesh has no triangles are hit as their AABB, filter(object) returning false skips an object
+	template <typename Filter = AcceptAll>
+	bool raycast(const Ray& ray, RayHit& hit, Filter filter = {}) {
+		return sphereCast(ray, 0.0f, hit, filter);
+	}
+
+	// Every object the ray hits, appended to hits nearest first
+	template <typename Filter = AcceptAll>
+	void raycastAll(const Ray& ray, std::vector<RayHit>& hits, Filter filter = {}) {
+		sphereCastAll(ray, 0.0f, hits, filter);
+	}
+
+	// raycast for a sphere of the given radius moving along the ray, hit.point is where it first touches
+	template <typename Filter = AcceptAll>
+	bool sphereCast(const Ray& ray, float radius, RayHit& hit, Filter filter = {}) {
+		prepareCasts(false);
+		return castClosest(ray, radius, hit, filter);
+	}
+
+	template <typename Filter = AcceptAll>
+	void sphereCastAll(const Ray& ray, float radius, std::vector<RayHit>& hits, Filter filter = {}) {
+		prepareCasts(false);
+		std::size_t first = hits.size();
+		forEachCastCandidate(ray, radius, [&](GameObject* object, float) {
+			RayHit hit;
+			if (filter(object) && castObject(object, ray, radius, ray.maxDistance, hit)) {
+				hits.push_back(hit);
+			}
+			return ray.maxDistance;
+		});
+		// The spatial hash can offer an object once for every cell it is in, its copies all have the same distance
+		std::sort(hits.begin() + first, hits.end(), [](const RayHit& a, const RayHit& b) {
+			return a.distance < b.distance || (a.distance == b.distance && a.object < b.object);
+		});
+		hits.erase(std::unique(hits.begin() + first, hits.end(), [](const RayHit& a, const RayHit& b) {
+			return a.object == b.object;
+		}), hits.end());
+	}
+
+	// Closest hit of every ray (sphere casts with a radius), hits[i].object is null where ray i hits nothing
+	// Rays are split across the job system, filter(rayIndex, object) can skip objects per ray, such as the
+	// two ends of a line of sight check
+	template <typename Filter = AcceptAll>
+	void castRays(std::span<const Ray> rays, std::span<RayHit> hits, float radius = 0.0f, Filter filter = {}) {
+		prepareCasts(true);
+		auto castRange = [&](std::size_t first, std::size_t last) {
+			for (std::size_t i = first; i < last; ++i) {
+				castClosest(rays[i], radius, hits[i], [&](GameObject* object) {
+					return filter(i, object);
+				});
+			}
+		};
+		if (jobSystem) {
+			jobSystem->parallelFor(0, rays.size(), 64, castRange);
+		}
+		else {
+			castRange(0, rays.size());
+		}
+	}
+
+	// Objects whose AABB is at least partly inside the frustum, appended to results
+	void queryFrustum(const Frustum& frustum, std::vector<GameObject*>& results) {
+		syncBroadphase();
+		if (broadphaseType == BroadphaseType::AABBTree) {
+			aabbTree.queryFrustum(frustum, [&](GameObject* object) {
+				results.push_back(object);
+			});
+			return;
+		}
+		for (auto object : objects) {
+			glm::vec3 objectMin, objectMax;
+			object->getAABB(objectMin, objectMax);
+			if (frustum.intersects(objectMin, objectMax)) {
+				results.push_back(object);
+			}
+		}
+	}
+	// Gets object by its handle name
+	// If multiple objects have the same name, it returns an arbitrary one of them
+	// (the first one created until any of them is destroyed, as removal swaps the bucket's last entry into the gap)
+	GameObject* getObjectByName(std::string_view name) {
+		std::span<GameObject* const> named = nameIndex.get(name);
+		return named.empty() ? nullptr : named.front();
+	}
+
+	// Gets all objects with the given name, straight from the name index without copying
+	// The span is only valid until an object is added, destroyed or renamed
+	std::span<GameObject* const> getObjectListByName(std::string_view name) {
+		return nameIndex.get(name);
+	}
+
+	// Gets all objects with the given tag, same lifetime rules as getObjectListByName
+	std::span<GameObject* const> getObjectListByTag(std::string_view tag) {
+		return tagIndex.get(tag);
 	}
 
 	// Rotation is calculated once and stored locally in a variable until function is called again with a new rotation
 	// Slightly faster for constant repeated rotations
-	void rotateObjectsR(std::vector<GameObject*> objects, glm::vec3 rotation) {
-		// Precompute the rotation matrix
+	void rotateObjectsR(std::span<GameObject* const> objects, glm::vec3 rotation) {
+		// Precompute the rotation
 		if(rotation != storedRotation)
 		{
 			glm::mat4 rotationX = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
 			glm::mat4 rotationY = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
 			glm::mat4 rotationZ = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-			storedRMatrix = rotationZ * rotationY * rotationX;
+			storedRQuat = glm::normalize(glm::quat_cast(glm::mat3(rotationZ * rotationY * rotationX)));
+			storedRotation = rotation;
 		}
 
-		for (auto& object : objects) {
-			object->rotate(storedRMatrix);
-		}
-		objectsUpdated = true;
+		rotateObjects(objects, storedRQuat);
 	}
 
-	bool haveObjectsUpdated() {
-		if (objectsUpdated) {
-			objectsUpdated = false;
-			return true;
+	// Bulk transforms: each runs a SIMD kernel over the objects' transform slots,
+	// split across the job system for large batches. An object must not appear twice in one call
+
+	void translateObjects(std::span<GameObject* const> objects, glm::vec3 offset) {
+		transformObjects(objects, TranslateKernel{ objectTransforms.positions, offset });
+	}
+
+	// Rotates each object about its own position
+	void rotateObjects(std::span<GameObject* const> objects, glm::quat rotation) {
+		transformObjects(objects, RotateKernel{ objectTransforms.positions, objectTransforms.rotations, rotation, glm::vec3(0.0f), false });
+	}
+
+	// Rotates each object about its own position and swings the positions around pivot
+	void rotateObjectsAbout(std::span<GameObject* const> objects, glm::quat rotation, glm::vec3 pivot) {
+		transformObjects(objects, RotateKernel{ objectTransforms.positions, objectTransforms.rotations, rotation, pivot, true });
+	}
+
+	// Scales each object along its local axes and scales its distance from pivot, a zero pivot matches GameObject::scale
+	void scaleObjects(std::span<GameObject* const> objects, glm::vec3 scale, glm::vec3 pivot = glm::vec3(0.0f)) {
+		transformObjects(objects, ScaleKernel{ objectTransforms.positions, objectTransforms.scales, scale, pivot });
+	}
+
+	// Rebuilds every dirty model matrix in bulk, so the renderer's getModelMatrix calls find them clean
+	// The hierarchy goes first, as one pass in depth order, the kernel then only sees objects without a parent or children
+	void updateModelMatrices() {
+		objectTransforms.updateHierarchy();
+		auto updateRange = [](size_t first, size_t last) {
+			uint32_t slots[256];
+			for (size_t begin = first; begin < last; begin += 256) {
+				size_t end = std::min<size_t>(begin + 256, last);
+				size_t count = 0;
+				for (size_t slot = begin; slot < end; ++slot) {
+					if (objectTransforms.modelDirty[slot] && !objectTransforms.hierarchy.isInHierarchy(static_cast<uint32_t>(slot))) {
+						slots[count++] = static_cast<uint32_t>(slot);
+						objectTransforms.modelDirty[slot] = 0;
+					}
+				}
+				runTransformKernel(std::span<const uint32_t>(slots, count),
+					ModelMatrixKernel{ objectTransforms.positions, objectTransforms.rotations, objectTransforms.scales, objectTransforms.models.data() });
+			}
+		};
+		if (jobSystem) {
+			jobSystem->parallelFor(0, objectTransforms.size(), 4096, updateRange);
+		}
+		else {
+			updateRange(0, objectTransforms.size());
 		}
-		return false;
+	}
+
+	// Instances of destroyed objects the renderer still has to free, in destruction order
+	std::span<const ReleasedInstance> getReleasedInstances() const {
+		return releasedInstances;
+	}
+
+	void clearReleasedInstances() {
+		releasedInstances.clear();
 	}
 
 	std::vector<GameObject*>* getObjects() {
 		return &objects;
 	}
 
-	void addCube(float width, float height, float depth, glm::vec3 bottomLeft, std::string name) {
-		std::vector<glm::vec3> vertices;
-		std::vector<unsigned int> indices;
-
-		glm::vec3 v0 = bottomLeft;
-		glm::vec3 v1 = bottomLeft + glm::vec3(width, 0.0f, 0.0f);
-		glm::vec3 v2 = bottomLeft + glm::vec3(width, height, 0.0f);
-		glm::vec3 v3 = bottomLeft + glm::vec3(0.0f, height, 0.0f);
-		glm::vec3 v4 = bottomLeft + glm::vec3(0.0f, 0.0f, depth);
-		glm::vec3 v5 = bottomLeft + glm::vec3(width, 0.0f, depth);
-		glm::vec3 v6 = bottomLeft + glm::vec3(width, height, depth);
-		glm::vec3 v7 = bottomLeft + glm::vec3(0.0f, height, depth);
-
-		vertices.insert(vertices.end(), { v0, v1, v2, v3, v4, v5, v6, v7 });
-
-		indices.insert(indices.end(), {
-			0, 1, 2, 2, 3, 0, // Front face
-			4, 5, 6, 6, 7, 4, // Back face
-			0, 3, 7, 7, 4, 0, // Left face
-			1, 2, 6, 6, 5, 1, // Right face
-			3, 2, 6, 6, 7, 3, // Top face
-			0, 1, 5, 5, 4, 0  // Bottom face
-			});
+	// Destroys every object and frees all mesh data, then puts the origin back
+	// Object slabs are handed back to the system once nothing is left alive in them
+	void clearScene() {
+		while (!objects.empty()) {
+			destroyObject(objects.back());
+		}
+		gameObjectPool.releaseAll();
+		meshRegistry.clear();
+		cubeMesh = NO_MESH;
+		addOrigin();
+	}
+
+	AllocatorStats getObjectPoolStats() const {
+		return gameObjectPool.getStats();
+	}
+
+	AllocatorStats getMeshArenaStats() const {
+		return meshRegistry.getArenaStats();
+	}
+
+	MeshOptimizationStats getMeshOptimizationStats() const {
+		return meshRegistry.getOptimizationStats();
+	}
+
+	// SoA transform data of every live GameObject, indexed by GameObject::getSlot()
+	TransformStorage* getTransforms() {
+		return &objectTransforms;
+	}
+
+	// Refreshes the cached bounds of every object that moved, in slot order
+	// The kernel rebuilds transforms from the local position, rotation and scale, so objects in the hierarchy use their world matrix instead
+	void updateBounds() {
+		objectTransforms.updateHierarchy();
+		auto localBounds = [](uint32_t slot, glm::vec3& centre, glm::vec3& extent) {
+			MeshHandle mesh = objectTransforms.owners[slot]->mesh;
+			if (mesh == NO_MESH) {
+				centre = extent = glm::vec3(0.0f);
+				return;
+			}
+			const Mesh& local = meshRegistry.getMesh(mesh);
+			centre = (local.boundsMin + local.boundsMax) * 0.5f;
+			extent = (local.boundsMax - local.boundsMin) * 0.5f;
+		};
+		auto updateRange = [&localBounds](size_t first, size_t last) {
+			uint32_t slots[256];
+			for (size_t begin = first; begin < last; begin += 256) {
+				size_t end = std::min<size_t>(begin + 256, last);
+				size_t count = 0;
+				for (size_t slot = begin; slot < end; ++slot) {
+					if (!objectTransforms.boundsDirty[slot]) {
+						continue;
+					}
+					if (objectTransforms.hierarchy.isInHierarchy(static_cast<uint32_t>(slot))) {
+						objectTransforms.owners[slot]->updateAABB();
+					}
+					else {
+						slots[count++] = static_cast<uint32_t>(slot);
+						objectTransforms.boundsDirty[slot] = 0;
+					}
+				}
+				runTransformKernel(std::span<const uint32_t>(slots, count), BoundsKernel<decltype(localBounds)>{ objectTransforms.positions,
+					objectTransforms.rotations, objectTransforms.scales, objectTransforms.boundsMin, objectTransforms.boundsMax, localBounds });
+			}
+		};
+		// Each slot only writes its own bounds, so ranges can run on any thread
+		if (jobSystem) {
+			jobSystem->parallelFor(0, objectTransforms.size(), 1024, updateRange);
+		}
+		else {
+			updateRange(0, objectTransforms.size());
+		}
+	}
+
+	// Every cube shares one unit cube mesh, its size is carried by the object's scale
+	ObjectHandle addCube(float width, float height, float depth, glm::vec3 bottomLeft, std::string name) {
+		if (cubeMesh == NO_MESH) {
+			// Vertices are relative to the centre of the cube
+			static const glm::vec3 cubeVertices[] = {
+				glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f),
+				glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f),
+				glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f),
+				glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f)
+			};
+			static const unsigned int cubeIndices[] = {
+				0, 1, 2, 2, 3, 0, // Front face
+				4, 5, 6, 6, 7, 4, // Back face
+				0, 3, 7, 7, 4, 0, // Left face
+				1, 2, 6, 6, 5, 1, // Right face
+				3, 2, 6, 6, 7, 3, // Top face
+				0, 1, 5, 5, 4, 0  // Bottom face
+			};
+			cubeMesh = meshRegistry.addMesh(cubeVertices, cubeIndices);
+		}
+
+		glm::vec3 size = glm::vec3(width, height, depth);
+		GameObject* cube = new GameObject(bottomLeft + size / 2.0f, name, cubeMesh);
+		cube->setScale(size);
+		return addObject(cube);
+	}
+
+	// Loads the triangles of a Wavefront OBJ file as one mesh and adds an object using it, with its origin at position
+	// Parsing is split across the job system when one is set, an invalid handle comes back if the file can't be read
+	ObjectHandle addObj(const std::string& path, glm::vec3 position, std::string name, ObjImportStats* importStats = nullptr) {
+		ObjImporter importer;
+		bool loaded = importer.load(path, jobSystem);
+		if (importStats) {
+			*importStats = importer.getStats();
+		}
+		if (!loaded) {
+			std::cout << "ERROR::OBJ::IMPORT_FAILED: " << importer.getError() << std::endl;
+			return ObjectHandle();
+		}
+		MeshHandle mesh = meshRegistry.addMesh(importer.getVertices(), importer.getIndices());
+		return addObject(new GameObject(position, name, mesh));
+	}
 
-		glm::vec3 centre = bottomLeft + glm::vec3(width / 2, height / 2, depth / 2);
+	// Loads a binary glTF scene under a new root object at position, each node becomes an object parented the way the
+	// file has it, nodes whose mesh has several triangle lists get a child object for each
+	// An invalid handle comes back if the file can't be read, see GltfLoader for what is supported
+	// Meshes that can stay in the mapped file do, unoptimized, unless zeroCopy is off
+	ObjectHandle addGltf(const std::string& path, glm::vec3 position, std::string name, GltfLoadStats* loadStats = nullptr, bool zeroCopy = true) {
+		GltfLoader loader;
+		bool loaded = loader.load(path, zeroCopy);
+		if (loadStats) {
+			*loadStats = loader.getStats();
+		}
+		if (!loaded) {
+			std::cout << "ERROR::GLTF::LOAD_FAILED: " << loader.getError() << std::endl;
+			return ObjectHandle();
+		}
+		GameObject* root = new GameObject(position, name);
+		ObjectHandle rootHandle = addObject(root);
+		const std::vector<GltfNode>& nodes = loader.getScene().nodes;
+		std::vector<GameObject*> nodeObjects(nodes.size());
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			const GltfNode& node = nodes[i];
+			GameObject* object = new GameObject(node.translation, node.name, node.meshes.size() == 1 ? node.meshes[0] : NO_MESH);
+			object->setRotation(node.rotation);
+			object->setScale(node.scale);
+			addObject(object);
+			setParent(object, node.parent == UINT32_MAX ? root : nodeObjects[node.parent]);
+			nodeObjects[i] = object;
+			if (node.meshes.size() > 1) {
+				for (std::size_t primitive = 0; primitive < node.meshes.size(); ++primitive) {
+					GameObject* part = new GameObject(glm::vec3(0.0f), node.name + "/" + std::to_string(primitive), node.meshes[primitive]);
+					addObject(part);
+					setParent(part, object);
+				}
+			}
+		}
+		return rootHandle;
+	}
 
-		GameObject* cube = new GameObject(centre, name);
-		cube->vertices = vertices;
-		cube->indices = indices;
-		addObject(cube);
+	// Adds an object using a mesh baked with writeBakedMesh, mapped straight from the file with nothing rebuilt
+	// An invalid handle comes back if the file can't be read
+	ObjectHandle addBakedMesh(const std::string& path, glm::vec3 position, std::string name) {
+		std::string error;
+		MeshHandle mesh = loadBakedMesh(path, &error);
+		if (mesh == NO_MESH) {
+			std::cout << "ERROR::MESH::LOAD_FAILED: " << error << std::endl;
+			return ObjectHandle();
+		}
+		return addObject(new GameObject(position, name, mesh));
 	}
 
 private:
 	std::vector<GameObject*> objects;
+	std::vector<GameObject*> occluders; // in the order they were marked, which is the order they're drawn in
+	NameIndex<GameObject*> nameIndex;
+	NameIndex<GameObject*> tagIndex;
+	SweepAndPrune broadphase;
+	SpatialHash spatialHash;
+	AABBTreeBroadphase aabbTree;
+	Narrowphase narrowphase;
+	BroadphaseType broadphaseType = BroadphaseType::SweepAndPrune;
+	JobSystem* jobSystem = nullptr;
+
+	struct HandleEntry {
+		GameObject* object;
+		uint32_t generation;
+		uint32_t nextFree; // next free handle index, only meaningful while object is null
+	};
+	std::vector<HandleEntry> handles;
+	uint32_t freeHandle = UINT32_MAX;
 	glm::vec3 storedRotation = glm::vec3(0.0f, 0.0f, 0.0f);
-	glm::mat4 storedRMatrix = glm::mat4(1.0f);
+	glm::quat storedRQuat = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	MeshHandle cubeMesh = NO_MESH;
+
+	std::vector<uint32_t> overlappingSlots;
+	std::vector<ReleasedInstance> releasedInstances;
+
+	template <typename Kernel>
+	void transformObjects(std::span<GameObject* const> targets, const Kernel& kernel) {
+		auto transformRange = [&](size_t first, size_t last) {
+			uint32_t slots[256];
+			for (size_t begin = first; begin < last; begin += 256) {
+				size_t count = std::min<size_t>(256, last - begin);
+				for (size_t i = 0; i < count; ++i) {
+					uint32_t slot = targets[begin + i]->slot;
+					slots[i] = slot;
+					objectTransforms.modelDirty[slot] = 1;
+					objectTransforms.boundsDirty[slot] = 1;
+					objectTransforms.broadphaseDirty[slot] = 1;
+				}
+				runTransformKernel(std::span<const uint32_t>(slots, count), kernel);
+			}
+		};
+		if (jobSystem) {
+			jobSystem->parallelFor(0, targets.size(), 4096, transformRange);
+		}
+		else {
+			transformRange(0, targets.size());
+		}
+		objectTransforms.anyBroadphaseDirty = true;
+		// The shared lists aren't safe to append to from the jobs
+		// Children of moved objects are picked up by the next hierarchy pass
+		bool hierarchy = objectTransforms.hierarchy.hasNodes();
+		for (GameObject* object : targets) {
+			objectTransforms.markRenderDirty(object->slot);
+			if (hierarchy) {
+				objectTransforms.hierarchy.markDirty(object->slot);
+			}
+		}
+	}
+
+	// Slots of this manager's objects whose cached AABB overlaps the box, tested 4 or 8 at a time
+	// The span is reused by the next call
+	std::span<const uint32_t> findOverlappingSlots(glm::vec3 min, glm::vec3 max) {
+		updateBounds();
+		overlappingSlots.clear();
+		overlapIndices(min, max, AABBStreams::from(objectTransforms.boundsMin, objectTransforms.boundsMax), overlappingSlots);
+		// Transform slots are shared by every GameObject, drop any belonging to another manager
+		std::erase_if(overlappingSlots, [this](uint32_t slot) {
+			GameObject* object = objectTransforms.owners[slot];
+			return getObject(object->handle) != object;
+		});
+		return overlappingSlots;
+	}
+
+	// Brings whatever the casts read up to date, after which they only read and any number can run at once
+	// A single cast leaves model matrices to be rebuilt as it reaches them, a batch rebuilds them all first
+	void prepareCasts(bool batch) {
+		if (batch) {
+			updateModelMatrices();
+		}
+		syncBroadphase();
+		if (broadphaseType == BroadphaseType::SweepAndPrune) {
+			updateBounds();
+		}
+	}
+
+	// Calls visit(object, distance) for this manager's objects whose AABB, grown by radius, the ray enters within its max distance
+	// visit returns the new max distance, as with the broadphase ray queries, so a closest hit search can stop early
+	template <typename Visit>
+	void forEachCastCandidate(const Ray& ray, float radius, Visit visit) const {
+		switch (broadphaseType) {
+		case BroadphaseType::AABBTree:
+			aabbTree.querySweep(ray.origin, ray.direction, radius, ray.maxDistance, visit);
+			return;
+		case BroadphaseType::SpatialHash:
+			spatialHash.querySweep(ray.origin, ray.direction, radius, ray.maxDistance, visit);
+			return;
+		default:
+			break;
+		}
+		// Sweep and prune can't walk a ray, so the cached bounds are tested in bulk and the boxes hit visited nearest first
+		std::vector<std::pair<float, uint32_t>> candidates;
+		glm::vec3 inverseDirection = 1.0f / ray.direction;
+		rayBatch(ray.origin, inverseDirection, ray.maxDistance, radius, AABBStreams::from(objectTransforms.boundsMin, objectTransforms.boundsMax),
+			[&](std::size_t base, uint32_t bits) {
+				while (bits) {
+					uint32_t slot = static_cast<uint32_t>(base + std::countr_zero(bits));
+					bits &= bits - 1;
+					// Transform slots are shared by every GameObject, skip any belonging to another manager
+					GameObject* object = objectTransforms.owners[slot];
+					if (getObject(object->handle) == object) {
+						candidates.emplace_back(rayIntersectsAABB(ray.origin, inverseDirection, ray.maxDistance,
+							objectTransforms.boundsMin.get(slot) - radius, objectTransforms.boundsMax.get(slot) + radius), slot);
+					}
+				}
+			});
+		std::sort(candidates.begin(), candidates.end());
+		float maxDistance = ray.maxDistance;
+		for (const auto& candidate : candidates) {
+			if (candidate.first > maxDistance) {
+				break;
+			}
+			maxDistance = visit(objectTransforms.owners[candidate.second], candidate.first);
+		}
+	}
+
+	// Exact test of one object, against its mesh's triangles when it has any and its AABB otherwise
+	static bool castObject(GameObject* object, const Ray& ray, float radius, float maxDistance, RayHit& hit) {
+		bool found;
+		if (object->mesh != NO_MESH && meshRegistry.getMesh(object->mesh).indices.size() >= 3) {
+			const Mesh& mesh = meshRegistry.getMesh(object->mesh);
+			found = radius > 0.0f
+				? sphereCastMesh(object->getModelMatrix(), mesh.vertices, mesh.indices, ray.origin, ray.direction, radius, maxDistance, hit)
+				: rayMesh(object->getModelMatrix(), mesh.vertices, mesh.indices, ray.origin, ray.direction, maxDistance, hit);
+		}
+		else {
+			glm::vec3 min, max;
+			object->getAABB(min, max);
+			found = sphereCastBox(ray.origin, ray.direction, radius, min, max, maxDistance, hit);
+		}
+		if (found) {
+			hit.object = object;
+		}
+		return found;
+	}
+
+	template <typename Filter>
+	bool castClosest(const Ray& ray, float radius, RayHit& hit, Filter filter) const {
+		hit = RayHit();
+		forEachCastCandidate(ray, radius, [&](GameObject* object, float) {
+			RayHit candidate;
+			float maxDistance = hit.object ? hit.distance : ray.maxDistance;
+			if (filter(object) && castObject(object, ray, radius, maxDistance, candidate) && (!hit.object || candidate.distance < hit.distance)) {
+				hit = candidate;
+			}
+			return hit.object ? hit.distance : ray.maxDistance;
+		});
+		return hit.object != nullptr;
+	}
+
+	// Box meshes become oriented boxes, any other mesh is used as its convex hull
+	static bool getCollisionShape(GameObject* object, CollisionShape& shape) {
+		if (object->mesh == NO_MESH) {
+			return false;
+		}
+		const Mesh& mesh = meshRegistry.getMesh(object->mesh);
+		shape.model = object->getModelMatrix();
+		shape.localMin = mesh.boundsMin;
+		shape.localMax = mesh.boundsMax;
+		shape.vertices = mesh.box ? std::span<const glm::vec3>() : mesh.vertices;
+		return true;
+	}
+
+	uint32_t createProxy(GameObject* object, glm::vec3 min, glm::vec3 max) {
+		switch (broadphaseType) {
+		case BroadphaseType::SpatialHash:
+			return spatialHash.createProxy(object, min, max);
+		case BroadphaseType::AABBTree:
+			return aabbTree.createProxy(object, min, max, object->staticObject);
+		default:
+			return broadphase.createProxy(object, min, max);
+		}
+	}
+
+	void destroyProxy(GameObject* object) {
+		switch (broadphaseType) {
+		case BroadphaseType::SpatialHash:
+			spatialHash.destroyProxy(object->broadphaseProxy);
+			break;
+		case BroadphaseType::AABBTree:
+			aabbTree.destroyProxy(object->broadphaseProxy);
+			break;
+		default:
+			broadphase.destroyProxy(object->broadphaseProxy);
+			break;
+		}
+	}
+
+	// Pushes the bounds of every object that moved since the last call into the active broadphase
+	void syncBroadphase() {
+		objectTransforms.updateHierarchy();
+		if (!objectTransforms.anyBroadphaseDirty) {
+			return;
+		}
+		objectTransforms.anyBroadphaseDirty = false;
+		for (size_t slot = 0; slot < objectTransforms.size(); ++slot) {
+			if (objectTransforms.broadphaseDirty[slot]) {
+				GameObject* object = objectTransforms.owners[slot];
+				if (object->broadphaseProxy != NO_PROXY) {
+					glm::vec3 min, max;
+					object->getAABB(min, max);
+					switch (broadphaseType) {
+					case BroadphaseType::SpatialHash:
+						spatialHash.updateProxy(object->broadphaseProxy, min, max);
+						break;
+					case BroadphaseType::AABBTree:
+						aabbTree.updateProxy(object->broadphaseProxy, min, max);
+						break;
+					default:
+						broadphase.updateProxy(object->broadphaseProxy, min, max);
+						break;
+					}
+				}
+				objectTransforms.broadphaseDirty[slot] = 0;
+			}
+		}
+	}
+
+	void addOrigin() {
+		static const glm::vec3 pointVertices[] = { glm::vec3(0.0f, 0.0f, 0.0f) };
+		static const unsigned int pointIndices[] = { 0 };
+		MeshHandle point = meshRegistry.addMesh(pointVertices, pointIndices);
+		addObject(new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), "origin", point));
+	}
+
+	void unindexName(GameObject* object) {
+		if (object->nameEntry.id == NO_NAME) {
+			return;
+		}
+		GameObject* moved = nameIndex.remove(object->nameEntry.id, object->nameEntry.position);
+		if (moved) {
+			moved->nameEntry.position = object->nameEntry.position;
+		}
+		object->nameEntry = { NO_NAME, 0 };
+	}
 };
 #endif // OBJECTS_H
@@ -0,0 +1,253 @@
+// OcclusionCulling.h
+#ifndef OCCLUSIONCULLING_H
+#define OCCLUSIONCULLING_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <span>
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+#include <TransformKernels.h>
+
+// Counts from the occluders drawn since the last clear
+struct OcclusionStats {
+	std::size_t occluders = 0;
+	std::size_t triangles = 0; // after near plane clipping, including ones too small to cover a pixel centre
+};
+
+// -------------------------------------------
+// Declaration of OcclusionBuffer class
+// Low resolution depth buffer on the CPU: a few big occluders are rasterized into it, then a mip chain keeping the
+// farthest depth of every 2x2 block lets any box be tested against it by reading at most four texels
+// A box is only reported hidden when its nearest point is behind everything drawn over its whole screen rectangle,
+// everything here is single threaded and done in a fixed order, so the same scene always gives the same answer
+class OcclusionBuffer {
+public:
+	OcclusionBuffer(uint32_t width = 256, uint32_t height = 144) {
+		resize(width, height);
+	}
+
+	void resize(uint32_t newWidth, uint32_t newHeight) {
+		width = std::max<uint32_t>(newWidth, 1);
+		height = std::max<uint32_t>(newHeight, 1);
+		// Rows are padded to a whole register so every row can be written a full register at a time
+		stride = static_cast<uint32_t>((width + FloatLanes::width - 1) / FloatLanes::width * FloatLanes::width);
+		levels.clear();
+		levelWidths.clear();
+		levelHeights.clear();
+		uint32_t levelWidth = width, levelHeight = height;
+		levels.emplace_back(static_cast<std::size_t>(stride) * height);
+		levelWidths.push_back(stride);
+		levelHeights.push_back(height);
+		while (levelWidth > 1 || levelHeight > 1) {
+			levelWidth = (levelWidth + 1) / 2;
+			levelHeight = (levelHeight + 1) / 2;
+			levels.emplace_back(static_cast<std::size_t>(levelWidth) * levelHeight);
+			levelWidths.push_back(levelWidth);
+			levelHeights.push_back(levelHeight);
+		}
+		clear();
+	}
+
+	// Everything back to the far plane
+	void clear() {
+		std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+		stats = OcclusionStats();
+	}
+
+	// Draws a mesh's triangles, clipFromLocal takes its vertices to clip space (projection * view * model)
+	// Triangles are drawn from both sides, and only pixels whose centre they cover are written
+	void rasterize(const glm::mat4& clipFromLocal, std::span<const glm::vec3> vertices, std::span<const unsigned int> indices) {
+		stats.occluders++;
+		clipVertices.resize(vertices.size());
+		for (std::size_t i = 0; i < vertices.size(); ++i) {
+			clipVertices[i] = clipFromLocal * glm::vec4(vertices[i], 1.0f);
+		}
+		for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+			glm::vec4 polygon[4];
+			int count = clipNear(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]], polygon);
+			// Clipping off a corner leaves a quad, drawn as a fan
+			for (int corner = 2; corner < count; ++corner) {
+				drawTriangle(toScreen(polygon[0]), toScreen(polygon[corner - 1]), toScreen(polygon[corner]));
+			}
+		}
+	}
+
+	// Rebuilds the mip chain from the full resolution depth, call once every occluder is drawn
+	void buildHierarchy() {
+		for (std::size_t level = 1; level < levels.size(); ++level) {
+			const std::vector<float>& below = levels[level - 1];
+			std::vector<float>& above = levels[level];
+			// Level 0 rows carry padding past width, which never holds anything drawn
+			uint32_t belowWidth = level == 1 ? width : levelWidths[level - 1];
+			uint32_t belowStride = levelWidths[level - 1], belowHeight = levelHeights[level - 1];
+			for (uint32_t y = 0; y < levelHeights[level]; ++y) {
+				uint32_t y0 = y * 2, y1 = std::min(y0 + 1, belowHeight - 1);
+				for (uint32_t x = 0; x < levelWidths[level]; ++x) {
+					uint32_t x0 = x * 2, x1 = std::min(x0 + 1, belowWidth - 1);
+					above[static_cast<std::size_t>(y) * levelWidths[level] + x] = std::max(
+						std::max(below[static_cast<std::size_t>(y0) * belowStride + x0], below[static_cast<std::size_t>(y0) * belowStride + x1]),
+						std::max(below[static_cast<std::size_t>(y1) * belowStride + x0], below[static_cast<std::size_t>(y1) * belowStride + x1]));
+				}
+			}
+		}
+	}
+
+	// True if the world space box is certainly hidden behind what has been drawn, clipFromWorld as for the occluders
+	// Boxes reaching in front of the near plane always count as visible
+	bool isOccluded(const glm::mat4& clipFromWorld, glm::vec3 min, glm::vec3 max) const {
+		glm::vec2 screenMin(std::numeric_limits<float>::max()), screenMax(-std::numeric_limits<float>::max());
+		float nearest = 1.0f;
+		for (int corner = 0; corner < 8; ++corner) {
+			glm::vec4 clip = clipFromWorld * glm::vec4(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.0f);
+			if (clip.z < -clip.w || clip.w <= 0.0f) {
+				return false;
+			}
+			glm::vec3 screen = toScreen(clip);
+			screenMin = glm::min(screenMin, glm::vec2(screen));
+			screenMax = glm::max(screenMax, glm::vec2(screen));
+			nearest = std::min(nearest, screen.z);
+		}
+		// Only the part on screen can be seen, and boxes entirely off it are left to frustum culling
+		screenMin = glm::max(screenMin, glm::vec2(0.0f));
+		screenMax = glm::min(screenMax, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+		if (screenMin.x >= screenMax.x || screenMin.y >= screenMax.y) {
+			return false;
+		}
+		// The level where the rectangle is at most a texel across, so it touches at most 2x2 of them
+		float extent = std::max(std::max(screenMax.x - screenMin.x, screenMax.y - screenMin.y), 1.0f);
+		std::size_t level = std::min<std::size_t>(static_cast<std::size_t>(std::ceil(std::log2(extent))), levels.size() - 1);
+		uint32_t levelWidth = level == 0 ? width : levelWidths[level];
+		uint32_t x0 = std::min(static_cast<uint32_t>(screenMin.x) >> level, levelWidth - 1);
+		uint32_t x1 = std::min(static_cast<uint32_t>(screenMax.x) >> level, levelWidth - 1);
+		uint32_t y0 = std::min(static_cast<uint32_t>(screenMin.y) >> level, levelHeights[level] - 1);
+		uint32_t y1 = std::min(static_cast<uint32_t>(screenMax.y) >> level, levelHeights[level] - 1);
+		const std::vector<float>& depths = levels[level];
+		for (uint32_t y = y0; y <= y1; ++y) {
+			for (uint32_t x = x0; x <= x1; ++x) {
+				if (depths[static_cast<std::size_t>(y) * levelWidths[level] + x] >= nearest) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Depth in [0, 1] at a full resolution pixel, 1 where nothing was drawn
+	float getDepth(uint32_t x, uint32_t y) const {
+		return levels[0][static_cast<std::size_t>(y) * stride + x];
+	}
+
+	uint32_t getWidth() const {
+		return width;
+	}
+
+	uint32_t getHeight() const {
+		return height;
+	}
+
+	const OcclusionStats& getStats() const {
+		return stats;
+	}
+
+private:
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t stride = 0; // floats per row of level 0
+	std::vector<std::vector<float>> levels; // level 0 is the depth buffer itself, each level after halves it keeping the farthest depth
+	std::vector<uint32_t> levelWidths; // row length in floats, the padded stride for level 0
+	std::vector<uint32_t> levelHeights;
+	std::vector<glm::vec4> clipVertices;
+	OcclusionStats stats;
+
+	// Pixel coordinates with y up, plus depth in [0, 1]
+	glm::vec3 toScreen(glm::vec4 clip) const {
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		return glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+	}
+
+	// Cuts the triangle at the near plane (z = -w), writes the 0, 3 or 4 corners left and returns how many
+	static int clipNear(glm::vec4 a, glm::vec4 b, glm::vec4 c, glm::vec4* out) {
+		const glm::vec4 corners[3] = { a, b, c };
+		int count = 0;
+		for (int i = 0; i < 3; ++i) {
+			glm::vec4 from = corners[i], to = corners[(i + 1) % 3];
+			float fromDistance = from.z + from.w, toDistance = to.z + to.w;
+			if (fromDistance >= 0.0f) {
+				out[count++] = from;
+			}
+			if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+				out[count++] = from + (to - from) * (fromDistance / (fromDistance - toDistance));
+			}
+		}
+		return count;
+	}
+
+	// Edge functions evaluated a register of pixels at a time along each row of the triangle's bounding box
+	void drawTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2) {
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (!(std::abs(area) > 0.0f)) {
+			return;
+		}
+		stats.triangles++;
+		// Counter clockwise on screen, so inside is where every edge function is positive
+		if (area < 0.0f) {
+			std::swap(v1, v2);
+			area = -area;
+		}
+		int xMin = std::max(static_cast<int>(std::floor(std::min(std::min(v0.x, v1.x), v2.x))), 0);
+		int xMax = std::min(static_cast<int>(std::ceil(std::max(std::max(v0.x, v1.x), v2.x))), static_cast<int>(width) - 1);
+		int yMin = std::max(static_cast<int>(std::floor(std::min(std::min(v0.y, v1.y), v2.y))), 0);
+		int yMax = std::min(static_cast<int>(std::ceil(std::max(std::max(v0.y, v1.y), v2.y))), static_cast<int>(height) - 1);
+		if (xMin > xMax || yMin > yMax) {
+			return;
+		}
+
+		// Edge from a to b: (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x), as stepX * x + stepY * y + offset
+		const glm::vec3 from[3] = { v0, v1, v2 }, to[3] = { v1, v2, v0 };
+		float stepX[3], stepY[3], offset[3];
+		for (int edge = 0; edge < 3; ++edge) {
+			stepX[edge] = from[edge].y - to[edge].y;
+			stepY[edge] = to[edge].x - from[edge].x;
+			offset[edge] = -(stepX[edge] * from[edge].x + stepY[edge] * from[edge].y);
+		}
+		// NDC depth is linear in screen space, so it's a plane too
+		float depthX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+		float depthY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+		float depthOffset = v0.z - depthX * v0.x - depthY * v0.y;
+
+		float laneOffsets[FloatLanes::width];
+		for (std::size_t lane = 0; lane < FloatLanes::width; ++lane) {
+			laneOffsets[lane] = static_cast<float>(lane);
+		}
+		const FloatLanes lanes = FloatLanes::loadLanes(laneOffsets);
+		const FloatLanes zero = FloatLanes::broadcast(0.0f);
+		const FloatLanes allBits = FloatLanes::broadcast(std::bit_cast<float>(0xFFFFFFFFu));
+		int xStart = xMin / static_cast<int>(FloatLanes::width) * static_cast<int>(FloatLanes::width);
+		for (int y = yMin; y <= yMax; ++y) {
+			float* row = levels[0].data() + static_cast<std::size_t>(y) * stride;
+			float centreY = y + 0.5f;
+			for (int x = xStart; x <= xMax; x += static_cast<int>(FloatLanes::width)) {
+				// Pixel centres
+				FloatLanes centreX = lanes + FloatLanes::broadcast(x + 0.5f);
+				FloatLanes inside = FloatLanes::broadcast(stepX[0]) * centreX + FloatLanes::broadcast(stepY[0] * centreY + offset[0]);
+				inside = inside.min(FloatLanes::broadcast(stepX[1]) * centreX + FloatLanes::broadcast(stepY[1] * centreY + offset[1]));
+				inside = inside.min(FloatLanes::broadcast(stepX[2]) * centreX + FloatLanes::broadcast(stepY[2] * centreY + offset[2]));
+				FloatLanes depth = FloatLanes::broadcast(depthX) * centreX + FloatLanes::broadcast(depthY * centreY + depthOffset);
+				FloatLanes current = FloatLanes::loadLanes(row + x);
+				// Covered where no edge function is negative, and written where that is nearer than what's there
+				FloatLanes covered = FloatLanes::select(inside < zero, zero, allBits);
+				FloatLanes::select(covered & (depth < current), depth, current).storeLanes(row + x);
+			}
+		}
+	}
+};
+
+#endif // OCCLUSIONCULLING_H
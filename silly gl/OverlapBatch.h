@@ -0,0 +1,321 @@
+// OverlapBatch.h
+#ifndef OVERLAPBATCH_H
+#define OVERLAPBATCH_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+#include <SoA.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OVERLAP_BATCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OVERLAP_BATCH_SSE
+#endif
+
+// A batch of boxes stored as structure-of-arrays, viewed in place without copying
+struct AABBStreams {
+	const float* minX;
+	const float* minY;
+	const float* minZ;
+	const float* maxX;
+	const float* maxY;
+	const float* maxZ;
+	std::size_t count;
+
+	static AABBStreams from(const SoAVec3& min, const SoAVec3& max) {
+		return { min.x.data(), min.y.data(), min.z.data(), max.x.data(), max.y.data(), max.z.data(), min.size() };
+	}
+};
+
+// Tests one box against boxes [begin, count) 8 (AVX2) or 4 (SSE) at a time
+// emit(base, bits) is called for every group with a hit, bit n set means box base + n overlaps
+template <typename Emit>
+inline void overlapBatch(glm::vec3 min, glm::vec3 max, const AABBStreams& boxes, std::size_t begin, Emit emit) {
+	std::size_t i = begin;
+#if defined(OVERLAP_BATCH_AVX2)
+	const __m256 queryMinX = _mm256_set1_ps(min.x), queryMaxX = _mm256_set1_ps(max.x);
+	const __m256 queryMinY = _mm256_set1_ps(min.y), queryMaxY = _mm256_set1_ps(max.y);
+	const __m256 queryMinZ = _mm256_set1_ps(min.z), queryMaxZ = _mm256_set1_ps(max.z);
+	for (; i + 8 <= boxes.count; i += 8) {
+		__m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(boxes.minX + i), queryMaxX, _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_loadu_ps(boxes.maxX + i), queryMinX, _CMP_GE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(boxes.minY + i), queryMaxY, _CMP_LE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(boxes.maxY + i), queryMinY, _CMP_GE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(boxes.minZ + i), queryMaxZ, _CMP_LE_OQ));
+		hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(boxes.maxZ + i), queryMinZ, _CMP_GE_OQ));
+		uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(hit));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#elif defined(OVERLAP_BATCH_SSE)
+	const __m128 queryMinX = _mm_set1_ps(min.x), queryMaxX = _mm_set1_ps(max.x);
+	const __m128 queryMinY = _mm_set1_ps(min.y), queryMaxY = _mm_set1_ps(max.y);
+	const __m128 queryMinZ = _mm_set1_ps(min.z), queryMaxZ = _mm_set1_ps(max.z);
+	for (; i + 4 <= boxes.count; i += 4) {
+		__m128 hit = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(boxes.minX + i), queryMaxX), _mm_cmpge_ps(_mm_loadu_ps(boxes.maxX + i), queryMinX));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(boxes.minY + i), queryMaxY));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(boxes.maxY + i), queryMinY));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(boxes.minZ + i), queryMaxZ));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(boxes.maxZ + i), queryMinZ));
+		uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(hit));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#endif
+	// Whatever doesn't fill a whole register
+	for (; i < boxes.count; ++i) {
+		if (boxes.minX[i] <= max.x && boxes.maxX[i] >= min.x &&
+			boxes.minY[i] <= max.y && boxes.maxY[i] >= min.y &&
+			boxes.minZ[i] <= max.z && boxes.maxZ[i] >= min.z) {
+			emit(i, 1u);
+		}
+	}
+}
+
+// Slab tests one ray against every box, each grown by radius, 8 (AVX2) or 4 (SSE) at a time
+// emit(base, bits) is called like overlapBatch's, for the boxes the ray enters within maxDistance
+// inverseDirection is 1 / direction, infinite components are fine
+template <typename Emit>
+inline void rayBatch(glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, float radius, const AABBStreams& boxes, Emit emit) {
+	// min - radius - origin and max + radius - origin, with the constant parts folded together
+	glm::vec3 nearOffset = origin + radius, farOffset = origin - radius;
+	std::size_t i = 0;
+#if defined(OVERLAP_BATCH_AVX2)
+	const float* mins[3] = { boxes.minX, boxes.minY, boxes.minZ };
+	const float* maxs[3] = { boxes.maxX, boxes.maxY, boxes.maxZ };
+	for (; i + 8 <= boxes.count; i += 8) {
+		__m256 enter = _mm256_setzero_ps(), exit = _mm256_set1_ps(maxDistance);
+		for (int axis = 0; axis < 3; ++axis) {
+			__m256 inverse = _mm256_set1_ps(inverseDirection[axis]);
+			__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(mins[axis] + i), _mm256_set1_ps(nearOffset[axis])), inverse);
+			__m256 t2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(maxs[axis] + i), _mm256_set1_ps(farOffset[axis])), inverse);
+			enter = _mm256_max_ps(enter, _mm256_min_ps(t1, t2));
+			exit = _mm256_min_ps(exit, _mm256_max_ps(t1, t2));
+		}
+		uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ)));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#elif defined(OVERLAP_BATCH_SSE)
+	const float* mins[3] = { boxes.minX, boxes.minY, boxes.minZ };
+	const float* maxs[3] = { boxes.maxX, boxes.maxY, boxes.maxZ };
+	for (; i + 4 <= boxes.count; i += 4) {
+		__m128 enter = _mm_setzero_ps(), exit = _mm_set1_ps(maxDistance);
+		for (int axis = 0; axis < 3; ++axis) {
+			__m128 inverse = _mm_set1_ps(inverseDirection[axis]);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(mins[axis] + i), _mm_set1_ps(nearOffset[axis])), inverse);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxs[axis] + i), _mm_set1_ps(farOffset[axis])), inverse);
+			enter = _mm_max_ps(enter, _mm_min_ps(t1, t2));
+			exit = _mm_min_ps(exit, _mm_max_ps(t1, t2));
+		}
+		uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#endif
+	for (; i < boxes.count; ++i) {
+		glm::vec3 t1 = (glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]) - nearOffset) * inverseDirection;
+		glm::vec3 t2 = (glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]) - farOffset) * inverseDirection;
+		glm::vec3 tNear = glm::min(t1, t2), tFar = glm::max(t1, t2);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		if (enter <= exit) {
+			emit(i, 1u);
+		}
+	}
+}
+
+// Tests boxes [begin, end) against six inward facing planes (as in Frustum), begin must be a multiple of 8
+// emit(base, bits) is called like overlapBatch's, for the boxes that aren't entirely behind any plane
+// Each plane only ever looks at the corner furthest along its normal, so which streams it reads is decided once per plane
+template <typename Emit>
+inline void frustumBatch(const glm::vec4 (&planes)[6], const AABBStreams& boxes, std::size_t begin, std::size_t end, Emit emit) {
+	const float* corner[6][3];
+	for (int plane = 0; plane < 6; ++plane) {
+		corner[plane][0] = planes[plane].x >= 0.0f ? boxes.maxX : boxes.minX;
+		corner[plane][1] = planes[plane].y >= 0.0f ? boxes.maxY : boxes.minY;
+		corner[plane][2] = planes[plane].z >= 0.0f ? boxes.maxZ : boxes.minZ;
+	}
+	std::size_t i = begin;
+#if defined(OVERLAP_BATCH_AVX2)
+	for (; i + 8 <= end; i += 8) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int plane = 0; plane < 6; ++plane) {
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(corner[plane][0] + i), _mm256_set1_ps(planes[plane].x)), _mm256_set1_ps(planes[plane].w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_loadu_ps(corner[plane][1] + i), _mm256_set1_ps(planes[plane].y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_loadu_ps(corner[plane][2] + i), _mm256_set1_ps(planes[plane].z)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#elif defined(OVERLAP_BATCH_SSE)
+	for (; i + 4 <= end; i += 4) {
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int plane = 0; plane < 6; ++plane) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(corner[plane][0] + i), _mm_set1_ps(planes[plane].x)), _mm_set1_ps(planes[plane].w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(corner[plane][1] + i), _mm_set1_ps(planes[plane].y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(corner[plane][2] + i), _mm_set1_ps(planes[plane].z)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+		}
+		uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(inside));
+		if (bits) {
+			emit(i, bits);
+		}
+	}
+#endif
+	for (; i < end; ++i) {
+		bool inside = true;
+		for (int plane = 0; plane < 6 && inside; ++plane) {
+			inside = corner[plane][0][i] * planes[plane].x + planes[plane].w + corner[plane][1][i] * planes[plane].y + corner[plane][2][i] * planes[plane].z >= 0.0f;
+		}
+		if (inside) {
+			emit(i, 1u);
+		}
+	}
+}
+
+// Sets bit i of mask for every box i in [begin, end) inside the planes, begin must be a multiple of 64
+// so ranges split that way can run on different threads without sharing a word
+inline void frustumMask(const glm::vec4 (&planes)[6], const AABBStreams& boxes, std::size_t begin, std::size_t end, uint64_t* mask) {
+	frustumBatch(planes, boxes, begin, end, [mask](std::size_t base, uint32_t bits) {
+		mask[base / 64] |= static_cast<uint64_t>(bits) << (base % 64);
+	});
+}
+
+// Sets bit i of mask (bit i % 64 of word i / 64) for every box i that overlaps, mask needs (count + 63) / 64 zeroed words
+inline void overlapMask(glm::vec3 min, glm::vec3 max, const AABBStreams& boxes, uint64_t* mask) {
+	overlapBatch(min, max, boxes, 0, [mask](std::size_t base, uint32_t bits) {
+		// Groups start on a multiple of their width, so a group never straddles two words
+		mask[base / 64] |= static_cast<uint64_t>(bits) << (base % 64);
+	});
+}
+
+// Writes the index of every box that overlaps into indices (room for boxes.count needed), returns how many
+inline std::size_t overlapIndices(glm::vec3 min, glm::vec3 max, const AABBStreams& boxes, uint32_t* indices) {
+	std::size_t found = 0;
+	overlapBatch(min, max, boxes, 0, [&](std::size_t base, uint32_t bits) {
+		while (bits) {
+			indices[found++] = static_cast<uint32_t>(base + std::countr_zero(bits));
+			bits &= bits - 1;
+		}
+	});
+	return found;
+}
+
+inline void overlapIndices(glm::vec3 min, glm::vec3 max, const AABBStreams& boxes, std::vector<uint32_t>& indices) {
+	std::size_t start = indices.size();
+	indices.resize(start + boxes.count);
+	indices.resize(start + overlapIndices(min, max, boxes, indices.data() + start));
+}
+
+// Every overlapping (index in a, index in b) pair, appended to pairs
+inline void overlapPairs(const AABBStreams& a, const AABBStreams& b, std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+	for (uint32_t i = 0; i < a.count; ++i) {
+		glm::vec3 min(a.minX[i], a.minY[i], a.minZ[i]);
+		glm::vec3 max(a.maxX[i], a.maxY[i], a.maxZ[i]);
+		overlapBatch(min, max, b, 0, [&](std::size_t base, uint32_t bits) {
+			while (bits) {
+				pairs.emplace_back(i, static_cast<uint32_t>(base + std::countr_zero(bits)));
+				bits &= bits - 1;
+			}
+		});
+	}
+}
+
+// Every overlapping pair within one batch, each reported once with the lower index first
+inline void overlapPairs(const AABBStreams& boxes, std::vector<std::pair<uint32_t, uint32_t>>& pairs) {
+	for (uint32_t i = 0; i < boxes.count; ++i) {
+		glm::vec3 min(boxes.minX[i], boxes.minY[i], boxes.minZ[i]);
+		glm::vec3 max(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+		overlapBatch(min, max, boxes, i + 1, [&](std::size_t base, uint32_t bits) {
+			while (bits) {
+				pairs.emplace_back(i, static_cast<uint32_t>(base + std::countr_zero(bits)));
+				bits &= bits - 1;
+			}
+		});
+	}
+}
+
+// Times overlapIndices against the one pair at a time scalar AABB test ObjectManager::checkCollision starts with,
+// over boxCount random boxes and queryCount random queries, and prints both to the console
+inline void benchmarkOverlap(std::size_t boxCount = 100000, std::size_t queryCount = 200) {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	SoAVec3 boxMin, boxMax;
+	boxMin.reserve(boxCount);
+	boxMax.reserve(boxCount);
+	for (std::size_t i = 0; i < boxCount; ++i) {
+		glm::vec3 min(position(random), position(random), position(random));
+		boxMin.push(min);
+		boxMax.push(min + glm::vec3(size(random), size(random), size(random)));
+	}
+	AABBStreams boxes = AABBStreams::from(boxMin, boxMax);
+
+	std::vector<glm::vec3> queryMin(queryCount), queryMax(queryCount);
+	for (std::size_t q = 0; q < queryCount; ++q) {
+		queryMin[q] = glm::vec3(position(random), position(random), position(random));
+		queryMax[q] = queryMin[q] + glm::vec3(10.0f);
+	}
+
+	std::vector<uint32_t> indices(boxCount);
+	std::size_t scalarHits = 0, batchHits = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q) {
+		glm::vec3 min = queryMin[q], max = queryMax[q];
+		std::size_t found = 0;
+		for (uint32_t i = 0; i < boxCount; ++i) {
+			glm::vec3 otherMin = boxMin.get(i), otherMax = boxMax.get(i);
+			bool collisionX = (min.x <= otherMax.x && max.x >= otherMin.x);
+			bool collisionY = (min.y <= otherMax.y && max.y >= otherMin.y);
+			bool collisionZ = (min.z <= otherMax.z && max.z >= otherMin.z);
+			if (collisionX && collisionY && collisionZ) {
+				indices[found++] = i;
+			}
+		}
+		scalarHits += found;
+	}
+	auto middle = std::chrono::high_resolution_clock::now();
+	for (std::size_t q = 0; q < queryCount; ++q) {
+		batchHits += overlapIndices(queryMin[q], queryMax[q], boxes, indices.data());
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double tests = static_cast<double>(boxCount) * static_cast<double>(queryCount);
+	double scalarTime = std::chrono::duration<double, std::nano>(middle - start).count();
+	double batchTime = std::chrono::duration<double, std::nano>(end - middle).count();
+#if defined(OVERLAP_BATCH_AVX2)
+	const char* path = "AVX2";
+#elif defined(OVERLAP_BATCH_SSE)
+	const char* path = "SSE";
+#else
+	const char* path = "scalar fallback";
+#endif
+	std::cout << "Overlap benchmark, " << boxCount << " boxes x " << queryCount << " queries\n";
+	std::cout << "  scalar: " << scalarTime / tests << " ns per test, " << scalarHits << " hits\n";
+	std::cout << "  batched (" << path << "): " << batchTime / tests << " ns per test, " << batchHits << " hits, "
+		<< scalarTime / batchTime << "x faster\n";
+}
+
+#endif // OVERLAPBATCH_H
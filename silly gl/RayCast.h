@@ -0,0 +1,287 @@
+// RayCast.h
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <span>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+#include <Broadphase.h>
+
+const uint32_t NO_TRIANGLE = UINT32_MAX;
+
+// A ray from origin along a unit length direction, so distances along it are in world units
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float maxDistance = std::numeric_limits<float>::infinity();
+
+	static Ray fromDirection(glm::vec3 origin, glm::vec3 direction, float maxDistance = std::numeric_limits<float>::infinity()) {
+		return { origin, glm::normalize(direction), maxDistance };
+	}
+
+	// The segment from from to to, as a ray that stops at to
+	static Ray fromSegment(glm::vec3 from, glm::vec3 to) {
+		float length = glm::length(to - from);
+		if (length == 0.0f) {
+			return { from, glm::vec3(0.0f, 0.0f, 1.0f), 0.0f };
+		}
+		return { from, (to - from) / length, length };
+	}
+};
+
+// What a ray or sphere cast ran into, object is null on a miss
+struct RayHit {
+	GameObject* object = nullptr;
+	float distance = 0.0f; // along the ray, for a sphere cast how far its centre travelled
+	glm::vec3 point = glm::vec3(0.0f); // on the surface that was hit
+	glm::vec3 normal = glm::vec3(0.0f); // unit length, facing back towards the ray
+	uint32_t triangle = NO_TRIANGLE; // which triangle of the object's mesh, NO_TRIANGLE when only its AABB was hit
+};
+
+// Default filter for the casts, accepts every object
+struct AcceptAll {
+	template <typename... Args>
+	bool operator()(Args&&...) const {
+		return true;
+	}
+};
+
+// Moller-Trumbore, hits either side of the triangle
+// Returns the hit distance in multiples of direction, which doesn't need to be unit length, or a negative value on a miss
+inline float rayTriangle(glm::vec3 origin, glm::vec3 direction, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+	glm::vec3 edge1 = b - a;
+	glm::vec3 edge2 = c - a;
+	glm::vec3 p = glm::cross(direction, edge2);
+	float determinant = glm::dot(edge1, p);
+	// The ray runs along the triangle's plane
+	if (determinant == 0.0f) {
+		return -1.0f;
+	}
+	float inverseDeterminant = 1.0f / determinant;
+	glm::vec3 s = origin - a;
+	float u = glm::dot(s, p) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f) {
+		return -1.0f;
+	}
+	glm::vec3 q = glm::cross(s, edge1);
+	float v = glm::dot(direction, q) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f) {
+		return -1.0f;
+	}
+	return glm::dot(edge2, q) * inverseDeterminant;
+}
+
+// Nearest point of the triangle to point, by which of its regions the point projects into (Ericson 5.1.5)
+inline glm::vec3 closestPointOnTriangle(glm::vec3 point, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = point - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return a;
+	}
+	glm::vec3 bp = point - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return a + ab * (d1 / (d1 - d3));
+	}
+	glm::vec3 cp = point - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// First distance within maxDistance at which a sphere moving along a unit direction touches the triangle, and where on it
+// A sphere that already touches the triangle at origin hits at 0
+inline bool sphereCastTriangle(glm::vec3 origin, glm::vec3 direction, float radius, glm::vec3 a, glm::vec3 b, glm::vec3 c,
+	float maxDistance, float& distance, glm::vec3& contact) {
+	glm::vec3 closest = closestPointOnTriangle(origin, a, b, c);
+	if (glm::dot(closest - origin, closest - origin) <= radius * radius) {
+		distance = 0.0f;
+		contact = closest;
+		return true;
+	}
+	// The sphere meets the plane first, if that point is inside the triangle nothing can be touched any earlier
+	glm::vec3 faceNormal = glm::cross(b - a, c - a);
+	float area = glm::length(faceNormal);
+	if (area > 0.0f) {
+		glm::vec3 normal = faceNormal / area;
+		float height = glm::dot(origin - a, normal);
+		if (height < 0.0f) {
+			normal = -normal;
+			height = -height;
+		}
+		float approach = -glm::dot(direction, normal);
+		if (approach > 0.0f) {
+			float t = (height - radius) / approach;
+			glm::vec3 point = origin + direction * t - normal * radius;
+			if (t >= 0.0f && t <= maxDistance &&
+				glm::dot(glm::cross(b - a, point - a), faceNormal) >= 0.0f &&
+				glm::dot(glm::cross(c - b, point - b), faceNormal) >= 0.0f &&
+				glm::dot(glm::cross(a - c, point - c), faceNormal) >= 0.0f) {
+				distance = t;
+				contact = point;
+				return true;
+			}
+		}
+	}
+	// Otherwise it first touches an edge, a cylinder around it, or a corner, a sphere around it
+	bool found = false;
+	const glm::vec3 corners[3] = { a, b, c };
+	for (int i = 0; i < 3; ++i) {
+		glm::vec3 start = corners[i], edge = corners[(i + 1) % 3] - start;
+		glm::vec3 offset = origin - start;
+		float edgeLengthSquared = glm::dot(edge, edge);
+		float edgeDirection = glm::dot(edge, direction);
+		float edgeOffset = glm::dot(edge, offset);
+		float quadraticA = edgeLengthSquared - edgeDirection * edgeDirection;
+		float quadraticB = edgeLengthSquared * glm::dot(direction, offset) - edgeDirection * edgeOffset;
+		float quadraticC = edgeLengthSquared * (glm::dot(offset, offset) - radius * radius) - edgeOffset * edgeOffset;
+		float discriminant = quadraticB * quadraticB - quadraticA * quadraticC;
+		// Moving along the edge, in which case a corner is touched first
+		if (quadraticA > 1e-8f * edgeLengthSquared && discriminant >= 0.0f) {
+			float t = (-quadraticB - std::sqrt(discriminant)) / quadraticA;
+			float along = edgeOffset + t * edgeDirection;
+			if (t >= 0.0f && t <= maxDistance && along >= 0.0f && along <= edgeLengthSquared) {
+				maxDistance = t;
+				contact = start + edge * (along / edgeLengthSquared);
+				found = true;
+			}
+		}
+		glm::vec3 fromCorner = origin - start;
+		float towards = glm::dot(fromCorner, direction);
+		float cornerDiscriminant = towards * towards - (glm::dot(fromCorner, fromCorner) - radius * radius);
+		if (cornerDiscriminant >= 0.0f) {
+			float t = -towards - std::sqrt(cornerDiscriminant);
+			if (t >= 0.0f && t <= maxDistance) {
+				maxDistance = t;
+				contact = start;
+				found = true;
+			}
+		}
+	}
+	if (found) {
+		distance = maxDistance;
+	}
+	return found;
+}
+
+// Closest triangle of a mesh placed by model that the ray hits within maxDistance, object is left for the caller
+// The ray is taken into the mesh's local space rather than every vertex out of it
+inline bool rayMesh(const glm::mat4& model, std::span<const glm::vec3> vertices, std::span<const unsigned int> indices,
+	glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit& hit) {
+	glm::mat4 inverse = glm::inverse(model);
+	glm::vec3 localOrigin = glm::vec3(inverse * glm::vec4(origin, 1.0f));
+	// Not normalised, so a distance along it is the same distance along the world ray
+	glm::vec3 localDirection = glm::mat3(inverse) * direction;
+	float closest = maxDistance;
+	uint32_t found = NO_TRIANGLE;
+	for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+		float t = rayTriangle(localOrigin, localDirection, vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+		if (t >= 0.0f && t <= closest) {
+			closest = t;
+			found = static_cast<uint32_t>(i / 3);
+		}
+	}
+	if (found == NO_TRIANGLE) {
+		return false;
+	}
+	glm::vec3 a = vertices[indices[found * 3]], b = vertices[indices[found * 3 + 1]], c = vertices[indices[found * 3 + 2]];
+	// Normals go back to world space by the inverse transpose, so a non-uniform scale doesn't skew them
+	glm::vec3 normal = glm::normalize(glm::transpose(glm::mat3(inverse)) * glm::cross(b - a, c - a));
+	hit.distance = closest;
+	hit.point = origin + direction * closest;
+	hit.normal = glm::dot(normal, direction) > 0.0f ? -normal : normal;
+	hit.triangle = found;
+	return true;
+}
+
+// rayMesh for a sphere, done in world space as a non-uniform scale would turn it into an ellipsoid in local space
+inline bool sphereCastMesh(const glm::mat4& model, std::span<const glm::vec3> vertices, std::span<const unsigned int> indices,
+	glm::vec3 origin, glm::vec3 direction, float radius, float maxDistance, RayHit& hit) {
+	uint32_t found = NO_TRIANGLE;
+	glm::vec3 contact;
+	for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+		glm::vec3 a = glm::vec3(model * glm::vec4(vertices[indices[i]], 1.0f));
+		glm::vec3 b = glm::vec3(model * glm::vec4(vertices[indices[i + 1]], 1.0f));
+		glm::vec3 c = glm::vec3(model * glm::vec4(vertices[indices[i + 2]], 1.0f));
+		float t;
+		glm::vec3 point;
+		if (sphereCastTriangle(origin, direction, radius, a, b, c, maxDistance, t, point)) {
+			maxDistance = t;
+			contact = point;
+			found = static_cast<uint32_t>(i / 3);
+		}
+	}
+	if (found == NO_TRIANGLE) {
+		return false;
+	}
+	glm::vec3 away = origin + direction * maxDistance - contact;
+	float length = glm::length(away);
+	hit.distance = maxDistance;
+	hit.point = contact;
+	hit.normal = length > 0.0f ? away / length : -direction;
+	hit.triangle = found;
+	return true;
+}
+
+// For objects with nothing but an AABB to hit, grown by radius for a sphere cast, normal is the face it enters through
+inline bool sphereCastBox(glm::vec3 origin, glm::vec3 direction, float radius, glm::vec3 min, glm::vec3 max, float maxDistance, RayHit& hit) {
+	float enter = 0.0f, exit = maxDistance;
+	int enterAxis = -1;
+	for (int axis = 0; axis < 3; ++axis) {
+		float low = min[axis] - radius, high = max[axis] + radius;
+		// Parallel to this pair of faces, written out as 0 * infinity would give NaN for a ray lying in one of them
+		if (direction[axis] == 0.0f) {
+			if (origin[axis] < low || origin[axis] > high) {
+				return false;
+			}
+			continue;
+		}
+		float inverse = 1.0f / direction[axis];
+		float t1 = (low - origin[axis]) * inverse, t2 = (high - origin[axis]) * inverse;
+		if (t1 > t2) {
+			std::swap(t1, t2);
+		}
+		if (t1 > enter) {
+			enter = t1;
+			enterAxis = axis;
+		}
+		exit = std::min(exit, t2);
+	}
+	if (enter > exit) {
+		return false;
+	}
+	hit.distance = enter;
+	hit.point = glm::clamp(origin + direction * enter, min, max);
+	hit.normal = -direction;
+	// Otherwise it started inside
+	if (enterAxis >= 0) {
+		hit.normal = glm::vec3(0.0f);
+		hit.normal[enterAxis] = direction[enterAxis] > 0.0f ? -1.0f : 1.0f;
+	}
+	hit.triangle = NO_TRIANGLE;
+	return true;
+}
+
+#endif // RAYCAST_H
@@ -8,11 +8,35 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include <random>
 #include <iostream>
 #include <Camera.h>
 #include <shader_l.h>
 #include <Objects.h>
+#include <OcclusionCulling.h>
+
+// How mesh positions are stored on the GPU, the shader turns them back into floats with a per mesh offset and scale
+// Meshes with a GpuMeshSource holding positions ignore it, they keep the source's 12 byte floats
+enum class VertexFormat {
+    Float32, // a glm::vec3 exactly as registered, 16 bytes with GLM_FORCE_ALIGNED
+    Half16, // 8 bytes, half floats relative to the centre of the mesh's bounds
+    Unorm16, // 8 bytes, 16 bit fractions of the way across the mesh's bounds, the default
+};
+
+// What the last render call drew
+struct RenderStats {
+    std::size_t instances = 0; // objects with a mesh, drawn or not
+    std::size_t visible = 0;
+    std::size_t culled = 0; // entirely outside the camera's frustum
+    std::size_t occluded = 0; // inside the frustum but hidden behind occluders
+    std::size_t drawCalls = 0;
+    std::size_t triangles = 0; // over every visible instance
+    std::size_t lodInstances[MAX_MESH_LODS] = {}; // visible instances drawn at each level of detail
+    std::size_t lodTriangles[MAX_MESH_LODS] = {};
+    std::size_t vertexBytes = 0; // mesh data in the VBO and EBO
+    std::size_t indexBytes = 0;
+};
 
 class Renderer {
 public:
@@ -25,11 +49,9 @@ public:
         model(glm::mat4(1.0f)),
         objectManager(objManager),
         SCR_WIDTH(scr_width),
-        SCR_HEIGHT(scr_height)
+        SCR_HEIGHT(scr_height),
+        occlusionBuffer(256, std::max(256u * scr_height / std::max(scr_width, 1u), 1u))
     {
-        objects = objectManager->getObjects();
-        verticesUpdated = objectManager->haveObjectsUpdated();
-
         // Setup globally applied matrices
         model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         projection = glm::perspective(glm::radians(60.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
@@ -37,8 +59,13 @@ public:
         // Using EBO buffers, so vertices can be reused
         // Indices are always needed with vertices in this approach.
         glGenVertexArrays(1, &VAO);
+        glGenVertexArrays(1, &sourceVAO);
         glGenBuffers(1, &VBO);
+        glGenBuffers(1, &sourceVBO);
         glGenBuffers(1, &EBO);
+        glGenBuffers(1, &instanceVBO);
+        glGenBuffers(1, &visibleVBO);
+        glGenTextures(1, &instanceTexture);
 
         glBindVertexArray(VAO);
 
@@ -48,9 +75,35 @@ public:
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
 
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        setPositionAttribute();
         glEnableVertexAttribArray(0);
 
+        // Model matrices are read by the shader through a texture buffer, four texels each
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceVBO);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        // The per instance attribute is which of those matrices to use, from the list of visible instances
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        setInstanceOffset(0);
+
+        // Positions uploaded straight from a GpuMeshSource have a VBO of their own, always tightly packed floats,
+        // drawn through a second VAO that shares the EBO and the instance attribute
+        glBindVertexArray(sourceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sourceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        setInstanceOffset(0);
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
         glEnable(GL_DEPTH_TEST);
@@ -60,6 +113,9 @@ public:
         shader.setMat4("model", model);
         shader.setMat4("view", glm::mat4(1.0f));
         shader.setMat4("projection", projection);
+        shader.setInt("instanceMatrices", 0);
+        positionOffsetLocation = shader.getLocation("positionOffset");
+        positionScaleLocation = shader.getLocation("positionScale");
     }
 
     void setCamera(Camera* camera) {
@@ -67,6 +123,48 @@ public:
         view = &(globalCamera->view);
     }
 
+    // Instance matrices are filled, and objects culled, in parallel when a job system is set
+    void setJobSystem(JobSystem* jobs) {
+        jobSystem = jobs;
+    }
+
+    // With culling off every instance is drawn, which is mostly useful for comparing frame times
+    void setFrustumCulling(bool enabled) {
+        frustumCulling = enabled;
+    }
+
+    // Hides objects behind the ones marked with ObjectManager::setOccluder, off by default
+    // The occluders are drawn into a small depth buffer on the CPU, so only worth it when they hide a lot
+    void setOcclusionCulling(bool enabled) {
+        occlusionCulling = enabled;
+    }
+
+    // Uploads every mesh again in the new format, Unorm16 and Half16 take half the space of Float32
+    // Unorm16 is exact at the corners of the bounds and within 1/65535 of the mesh's size elsewhere
+    void setVertexFormat(VertexFormat format) {
+        if (format != vertexFormat) {
+            vertexFormat = format;
+            uploadMeshes();
+        }
+    }
+
+    // Objects switch to their mesh's coarser levels of detail, see MeshRegistry::generateLods, as they get smaller
+    // on screen, on by default but only meshes with levels generated are affected
+    void setLodSelection(bool enabled) {
+        lodSelection = enabled;
+    }
+
+    // errorPixels is how far, in pixels, a level's surface may be from the full mesh before a finer level is used
+    // An object only moves to a coarser level once it's under that by the hysteresis fraction, so it doesn't flicker
+    void setLodThreshold(float errorPixels, float hysteresis = 0.25f) {
+        lodErrorPixels = errorPixels;
+        lodHysteresis = hysteresis;
+    }
+
+    const RenderStats& getStats() const {
+        return stats;
+    }
+
     void render() {
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -75,57 +173,593 @@ public:
 			shader.setMat4("view", *view);
 		}
 
-        verticesUpdated = objectManager->haveObjectsUpdated();
-        if (verticesUpdated) {
-            std::vector<glm::vec3> combined_vertices;
-            std::vector<unsigned int> combined_indices;
-            firsts.clear();
-            counts.clear();
-
-            GLsizei vertex_offset = 0;
-            for (size_t i = 0; i < objects->size(); ++i) {
-                GameObject* obj = (*objects)[i];
-                const auto& verts = obj->vertices;
-                const auto& inds = obj->indices;
+        // Every registered mesh is uploaded once into the shared buffers, objects only reference them
+        if (meshRegistry.haveMeshesUpdated()) {
+            uploadMeshes();
+        }
 
-                firsts.push_back(static_cast<GLint>(combined_indices.size()));
-                counts.push_back(static_cast<GLsizei>(inds.size()));
+        // Only objects that were added, destroyed, moved or given a new mesh since the last frame are uploaded again
+        objectManager->updateModelMatrices();
+        updateInstances();
+        uploadInstances();
+        cullInstances();
 
-                combined_vertices.insert(combined_vertices.end(), verts.begin(), verts.end());
-                for (const auto& ind : inds) {
-                    combined_indices.push_back(ind + vertex_offset);
+        // One instanced draw per mesh and level of detail, over just its visible instances
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, instanceTexture);
+        stats.drawCalls = 0;
+        unsigned int boundVAO = 0;
+        for (size_t mesh = 0; mesh < groups.size() && mesh < meshRanges.size(); ++mesh) {
+            const MeshRange& meshRange = meshRanges[mesh];
+            bool uniformsSet = false;
+            for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+                size_t range = mesh * MAX_MESH_LODS + lod;
+                if (groups[mesh].visibleCount[lod] == 0 || counts[range] == 0) {
+                    continue;
                 }
-
-                vertex_offset += static_cast<GLsizei>(verts.size());
+                if (!uniformsSet) {
+                    unsigned int meshVAO = meshRange.fromSource ? sourceVAO : VAO;
+                    if (meshVAO != boundVAO) {
+                        glBindVertexArray(meshVAO);
+                        boundVAO = meshVAO;
+                    }
+                    shader.setVec3(positionOffsetLocation, meshRange.positionOffset);
+                    shader.setVec3(positionScaleLocation, meshRange.positionScale);
+                    uniformsSet = true;
+                }
+                setInstanceOffset(groups[mesh].visibleFirst[lod]);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, counts[range], meshRange.indexType, (void*)indexOffsets[range],
+                    groups[mesh].visibleCount[lod], meshRange.baseVertex);
+                stats.drawCalls++;
             }
-
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, combined_vertices.size() * sizeof(glm::vec3), combined_vertices.data(), GL_DYNAMIC_DRAW);
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, combined_indices.size() * sizeof(unsigned int), combined_indices.data(), GL_DYNAMIC_DRAW);
-        }
-
-        glBindVertexArray(VAO);
-        for (size_t i = 0; i < counts.size(); ++i) {
-            glDrawElements(GL_TRIANGLES, counts[i], GL_UNSIGNED_INT, (void*)(firsts[i] * sizeof(unsigned int)));
         }
         glBindVertexArray(0);   
     }
 
 private:
     float const vecSize = sizeof(float) * 3;
-    std::vector<GLint> firsts;
-    std::vector<GLsizei> counts;
-    bool verticesUpdated = true;
+    static constexpr size_t sourceStride = 3 * sizeof(float); // positions in sourceVBO
+    // Where each mesh sits in the VBO and how to read it back, indexed by MeshHandle
+    struct MeshRange {
+        GLint baseVertex = 0; // indices are local to the mesh
+        GLenum indexType = GL_UNSIGNED_INT;
+        bool fromSource = false; // positions are in sourceVBO, as the mesh's GpuMeshSource had them
+        glm::vec3 positionOffset = glm::vec3(0.0f); // position = offset + scale * stored position
+        glm::vec3 positionScale = glm::vec3(1.0f);
+    };
+    std::vector<MeshRange> meshRanges;
+    std::vector<size_t> indexOffsets; // byte offset of each mesh's levels of detail in the EBO, indexed by MeshHandle * MAX_MESH_LODS + level
+    std::vector<GLsizei> counts; // index count of each level, 0 past the mesh's last one
+    // Each mesh's instances sit together in the instance buffer, with room to grow before the buffer is laid out again
+    struct InstanceGroup {
+        GLint first = 0;
+        GLsizei count = 0;
+        GLsizei capacity = 0;
+        GLint visibleFirst[MAX_MESH_LODS] = {}; // this frame's visible instances at each level, ranges of visibleInstances
+        GLsizei visibleCount[MAX_MESH_LODS] = {};
+    };
+    std::vector<InstanceGroup> groups; // indexed by MeshHandle
+    std::vector<GameObject*> instanceObjects; // object drawn by each instance, null in unused room
+    std::vector<glm::mat4> instanceMatrices; // copy of the instance buffer
+    std::vector<uint32_t> dirtyInstances; // instances whose matrix has to be uploaded again, may repeat
+    std::vector<GameObject*> pendingObjects; // waiting for a full group to grow
+    bool instancesMoved = false; // groups were laid out again, so the whole buffer is uploaded
+    std::vector<uint64_t> visibleSlots; // bit per transform slot, set if its bounds touch the frustum
+    std::vector<uint64_t> occludedSlots; // bit per transform slot, set if it's in the frustum but hidden
+    std::vector<uint8_t> instanceVisible; // per instance, one of the Visibility values
+    std::vector<uint8_t> instanceLods; // per visible instance, the level of detail to draw it at
+    std::vector<uint32_t> visibleInstances; // uploaded each frame, grouped by mesh
+    bool frustumCulling = true;
+    bool occlusionCulling = false;
+    bool lodSelection = true;
+    float lodErrorPixels = 1.0f;
+    float lodHysteresis = 0.25f;
+    VertexFormat vertexFormat = VertexFormat::Unorm16;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    GLint positionOffsetLocation = -1;
+    GLint positionScaleLocation = -1;
+    RenderStats stats;
     unsigned int SCR_WIDTH;
     unsigned int SCR_HEIGHT;
-    std::vector<GameObject*>* objects;
     Camera* globalCamera;
     ObjectManager* objectManager;
-    unsigned int VAO, VBO, EBO;
+    OcclusionBuffer occlusionBuffer;
+    JobSystem* jobSystem = nullptr;
+    unsigned int VAO, VBO, EBO, instanceVBO, visibleVBO, instanceTexture;
+    unsigned int sourceVAO, sourceVBO;
     glm::mat4 projection, model;
-	glm::mat4* view; // only initialised if camera is set
+	glm::mat4* view = nullptr; // only set once a camera is
+
+    // Copies every mesh in the registry into the shared VBO and EBO, positions in the current vertex format
+    // Indices stay local to their mesh, drawn with a base vertex, so any mesh of up to 65536 vertices gets 16 bit ones
+    // Both buffers are laid out first, then each mesh is written into its place: data already in the GPU's layout
+    // (float positions, 32 bit indices) goes straight from the mesh's memory, only the rest is packed on the way
+    // A mesh's GpuMeshSource is uploaded as it is instead, positions into sourceVBO and level 0's indices keeping
+    // the source's size, so a mapped file goes into the buffers without being converted
+    void uploadMeshes() {
+        meshRanges.clear();
+        indexOffsets.clear();
+        counts.clear();
+
+        size_t stride = vertexStride();
+        size_t vertexSize = 0;
+        size_t sourceSize = 0;
+        size_t indexSize = 0;
+        for (MeshHandle handle = 0; handle < meshRegistry.size(); ++handle) {
+            const Mesh& mesh = meshRegistry.getMesh(handle);
+            const GpuMeshSource& source = mesh.gpuSource;
+            MeshRange range;
+            if (source.indices) {
+                range.indexType = source.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            }
+            else {
+                range.indexType = mesh.vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            }
+            if (source.positions) {
+                range.fromSource = true;
+                range.baseVertex = static_cast<GLint>(sourceSize / sourceStride);
+                sourceSize += mesh.vertices.size() * sourceStride;
+            }
+            else {
+                range.baseVertex = static_cast<GLint>(vertexSize / stride);
+                vertexSize += mesh.vertices.size() * stride;
+                if (vertexFormat == VertexFormat::Half16) {
+                    range.positionOffset = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+                }
+                else if (vertexFormat == VertexFormat::Unorm16) {
+                    range.positionOffset = mesh.boundsMin;
+                    range.positionScale = mesh.boundsMax - mesh.boundsMin;
+                }
+            }
+            meshRanges.push_back(range);
+
+            size_t elementSize = range.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+            for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+                size_t count = lod < mesh.lodCount ? mesh.lods[lod].indices.size() : 0;
+                // Every range starts aligned to its own index size
+                indexSize = (indexSize + elementSize - 1) / elementSize * elementSize;
+                indexOffsets.push_back(indexSize);
+                counts.push_back(static_cast<GLsizei>(count));
+                indexSize += count * elementSize;
+            }
+        }
+        vertexBytes = vertexSize + sourceSize;
+        indexBytes = indexSize;
+
+        // The EBO binding and the attribute format are part of the VAO state
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sourceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sourceSize, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexSize, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, GL_DYNAMIC_DRAW);
+
+        std::vector<uint8_t> packed;
+        std::vector<uint16_t> narrowed;
+        for (MeshHandle handle = 0; handle < meshRegistry.size(); ++handle) {
+            const Mesh& mesh = meshRegistry.getMesh(handle);
+            const MeshRange& range = meshRanges[handle];
+            if (range.fromSource) {
+                glBindBuffer(GL_ARRAY_BUFFER, sourceVBO);
+                glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(range.baseVertex) * sourceStride,
+                    mesh.vertices.size() * sourceStride, mesh.gpuSource.positions);
+                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            }
+            else if (!mesh.vertices.empty()) {
+                GLintptr offset = static_cast<GLintptr>(range.baseVertex) * stride;
+                if (vertexFormat == VertexFormat::Float32) {
+                    glBufferSubData(GL_ARRAY_BUFFER, offset, mesh.vertices.size_bytes(), mesh.vertices.data());
+                }
+                else {
+                    packed.clear();
+                    appendVertices(mesh.vertices, range, packed);
+                    glBufferSubData(GL_ARRAY_BUFFER, offset, packed.size(), packed.data());
+                }
+            }
+            for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+                std::span<const unsigned int> indices = mesh.lods[lod].indices;
+                GLintptr offset = static_cast<GLintptr>(indexOffsets[handle * MAX_MESH_LODS + lod]);
+                if (indices.empty()) {
+                    continue;
+                }
+                if (lod == 0 && mesh.gpuSource.indices) {
+                    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, indices.size() * mesh.gpuSource.indexSize, mesh.gpuSource.indices);
+                    continue;
+                }
+                if (range.indexType == GL_UNSIGNED_INT) {
+                    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, indices.size_bytes(), indices.data());
+                    continue;
+                }
+                // Coarser levels only use level 0's vertices, so they fit in 16 bits whenever it does
+                narrowed.resize(indices.size());
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    narrowed[i] = static_cast<uint16_t>(indices[i]);
+                }
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, narrowed.size() * sizeof(uint16_t), narrowed.data());
+            }
+        }
+        setPositionAttribute();
+        glBindVertexArray(0);
+    }
+
+    // Encodes positions into the current vertex format, the inverse of what the shader does with the range's offset and scale
+    void appendVertices(std::span<const glm::vec3> vertices, const MeshRange& range, std::vector<uint8_t>& vertexData) const {
+        size_t stride = vertexStride();
+        size_t start = vertexData.size();
+        vertexData.resize(start + vertices.size() * stride);
+        uint8_t* out = vertexData.data() + start;
+        // A flat mesh has no extent on some axis, everything on it sits at the offset
+        glm::vec3 inverseScale = glm::vec3(
+            range.positionScale.x != 0.0f ? 1.0f / range.positionScale.x : 0.0f,
+            range.positionScale.y != 0.0f ? 1.0f / range.positionScale.y : 0.0f,
+            range.positionScale.z != 0.0f ? 1.0f / range.positionScale.z : 0.0f);
+        for (size_t i = 0; i < vertices.size(); ++i, out += stride) {
+            glm::vec3 local = (vertices[i] - range.positionOffset) * inverseScale;
+            if (vertexFormat == VertexFormat::Float32) {
+                std::memcpy(out, &vertices[i], sizeof(glm::vec3));
+            }
+            else {
+                // The fourth component pads each vertex to 8 bytes, keeping attributes 4 byte aligned
+                uint64_t packed = vertexFormat == VertexFormat::Half16 ? glm::packHalf4x16(glm::vec4(local, 0.0f)) : glm::packUnorm4x16(glm::vec4(local, 0.0f));
+                std::memcpy(out, &packed, sizeof(packed));
+            }
+        }
+    }
+
+    size_t vertexStride() const {
+        return vertexFormat == VertexFormat::Float32 ? sizeof(glm::vec3) : sizeof(uint64_t);
+    }
+
+    // Expects the VAO and VBO to be bound
+    void setPositionAttribute() {
+        GLenum type = vertexFormat == VertexFormat::Float32 ? GL_FLOAT : vertexFormat == VertexFormat::Half16 ? GL_HALF_FLOAT : GL_UNSIGNED_SHORT;
+        GLboolean normalized = vertexFormat == VertexFormat::Unorm16 ? GL_TRUE : GL_FALSE;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, type, normalized, static_cast<GLsizei>(vertexStride()), (void*)0);
+    }
+
+    // Drains the object manager's released instances and the dirty list into instance changes
+    void updateInstances() {
+        // Every destroyed object is gone already, so all of their instances are emptied before any gap is filled
+        for (const auto& released : objectManager->getReleasedInstances()) {
+            instanceObjects[released.instance] = nullptr;
+        }
+        for (const auto& released : objectManager->getReleasedInstances()) {
+            removeInstance(released.mesh, released.instance);
+        }
+        objectManager->clearReleasedInstances();
+
+        if (groups.size() < meshRegistry.size()) {
+            groups.resize(meshRegistry.size(), InstanceGroup{ static_cast<GLint>(instanceObjects.size()), 0, 0 });
+        }
+
+        for (uint32_t slot : objectTransforms.renderDirtySlots) {
+            GameObject* obj = objectTransforms.owners[slot];
+            // Objects only get drawn once they belong to the object manager
+            if (objectManager->getObject(obj->handle) != obj) {
+                continue;
+            }
+            if (obj->renderMesh != obj->mesh) {
+                if (obj->renderInstance != NO_INSTANCE) {
+                    removeInstance(obj->renderMesh, obj->renderInstance);
+                    obj->renderInstance = NO_INSTANCE;
+                }
+                obj->renderMesh = obj->mesh;
+                obj->renderLod = 0;
+                if (obj->mesh != NO_MESH) {
+                    addInstance(obj);
+                }
+            }
+            else if (obj->renderInstance != NO_INSTANCE) {
+                dirtyInstances.push_back(obj->renderInstance);
+            }
+        }
+        objectTransforms.clearRenderDirty();
+
+        if (!pendingObjects.empty()) {
+            growGroups();
+            for (GameObject* obj : pendingObjects) {
+                addInstance(obj);
+            }
+            pendingObjects.clear();
+        }
+    }
+
+    void addInstance(GameObject* obj) {
+        InstanceGroup& group = groups[obj->mesh];
+        if (group.count == group.capacity) {
+            pendingObjects.push_back(obj);
+            return;
+        }
+        uint32_t instance = static_cast<uint32_t>(group.first + group.count++);
+        instanceObjects[instance] = obj;
+        obj->renderInstance = instance;
+        dirtyInstances.push_back(instance);
+    }
+
+    // The group's last live instance fills the gap, so groups stay contiguous
+    // Empty instances at the end of the group, left by destroyed objects, are dropped on the way
+    void removeInstance(MeshHandle mesh, uint32_t instance) {
+        InstanceGroup& group = groups[mesh];
+        instanceObjects[instance] = nullptr;
+        trimGroup(group);
+        if (instance < static_cast<uint32_t>(group.first + group.count)) {
+            uint32_t last = static_cast<uint32_t>(group.first + --group.count);
+            instanceObjects[instance] = instanceObjects[last];
+            instanceObjects[instance]->renderInstance = instance;
+            instanceObjects[last] = nullptr;
+            dirtyInstances.push_back(instance);
+            trimGroup(group);
+        }
+    }
+
+    void trimGroup(InstanceGroup& group) {
+        while (group.count > 0 && !instanceObjects[group.first + group.count - 1]) {
+            group.count--;
+        }
+    }
+
+    // Lays every group out again with room for the objects waiting on it and half as many again
+    // Happens once per frame at most, every instance moves so the whole buffer goes up afterwards
+    void growGroups() {
+        std::vector<GLsizei> needed(groups.size(), 0);
+        for (GameObject* obj : pendingObjects) {
+            needed[obj->mesh]++;
+        }
+        std::vector<GameObject*> laidOut;
+        for (size_t mesh = 0; mesh < groups.size(); ++mesh) {
+            InstanceGroup& group = groups[mesh];
+            GLsizei count = group.count + needed[mesh];
+            GLsizei capacity = group.capacity;
+            if (count > capacity) {
+                capacity = std::max<GLsizei>(count + count / 2, 16);
+            }
+            GLint first = static_cast<GLint>(laidOut.size());
+            laidOut.resize(laidOut.size() + capacity, nullptr);
+            for (GLsizei i = 0; i < group.count; ++i) {
+                GameObject* obj = instanceObjects[group.first + i];
+                laidOut[first + i] = obj;
+                obj->renderInstance = static_cast<uint32_t>(first + i);
+            }
+            group.first = first;
+            group.capacity = capacity;
+        }
+        instanceObjects.swap(laidOut);
+        instanceMatrices.resize(instanceObjects.size());
+        dirtyInstances.clear();
+        instancesMoved = true;
+    }
+
+    // Refills and uploads only the dirty instances, neighbouring ones merged into a single glBufferSubData
+    void uploadInstances() {
+        auto fill = [this](uint32_t instance) {
+            if (instanceObjects[instance]) {
+                instanceMatrices[instance] = instanceObjects[instance]->getModelMatrix();
+            }
+        };
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (instancesMoved) {
+            auto fillRange = [&fill](size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i) {
+                    fill(static_cast<uint32_t>(i));
+                }
+            };
+            if (jobSystem) {
+                jobSystem->parallelFor(0, instanceObjects.size(), 1024, fillRange);
+            }
+            else {
+                fillRange(0, instanceObjects.size());
+            }
+            glBufferData(GL_ARRAY_BUFFER, instanceMatrices.size() * sizeof(glm::mat4), instanceMatrices.data(), GL_DYNAMIC_DRAW);
+            instancesMoved = false;
+            dirtyInstances.clear();
+            return;
+        }
+        if (dirtyInstances.empty()) {
+            return;
+        }
+
+        std::sort(dirtyInstances.begin(), dirtyInstances.end());
+        dirtyInstances.erase(std::unique(dirtyInstances.begin(), dirtyInstances.end()), dirtyInstances.end());
+        auto fillRange = [this, &fill](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                fill(dirtyInstances[i]);
+            }
+        };
+        if (jobSystem) {
+            jobSystem->parallelFor(0, dirtyInstances.size(), 1024, fillRange);
+        }
+        else {
+            fillRange(0, dirtyInstances.size());
+        }
+
+        // A small gap is cheaper to upload than another call, and past a quarter of the buffer one call covers everything dirty
+        const uint32_t mergeGap = dirtyInstances.size() * 4 > instanceObjects.size() ? UINT32_MAX : 16;
+        size_t run = 0;
+        while (run < dirtyInstances.size()) {
+            uint32_t first = dirtyInstances[run];
+            uint32_t last = first;
+            while (++run < dirtyInstances.size() && dirtyInstances[run] - last <= mergeGap) {
+                last = dirtyInstances[run];
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::mat4), (last - first + 1) * sizeof(glm::mat4), &instanceMatrices[first]);
+        }
+        dirtyInstances.clear();
+    }
+
+    enum Visibility : uint8_t { CULLED, VISIBLE, OCCLUDED };
+
+    // Tests every object's cached bounds against the frustum of projection * view * model, 8 or 4 at a time,
+    // then optionally against the occluders, and lists each mesh's visible instances together and uploads the list
+    void cullInstances() {
+        glm::mat4 clipFromWorld = projection * (view ? *view : glm::mat4(1.0f)) * model;
+        Frustum frustum = Frustum::fromMatrix(clipFromWorld);
+        std::size_t slotCount = objectTransforms.size();
+        if (frustumCulling || occlusionCulling || lodSelection) {
+            objectManager->updateBounds();
+        }
+        if (frustumCulling) {
+            visibleSlots.assign((slotCount + 63) / 64, 0);
+            AABBStreams bounds = AABBStreams::from(objectTransforms.boundsMin, objectTransforms.boundsMax);
+            // Split on whole words of the mask, so no two threads write the same one
+            auto cullRange = [&](size_t firstWord, size_t lastWord) {
+                frustumMask(frustum.planes, bounds, firstWord * 64, std::min(lastWord * 64, slotCount), visibleSlots.data());
+            };
+            if (jobSystem) {
+                jobSystem->parallelFor(0, visibleSlots.size(), 64, cullRange);
+            }
+            else {
+                cullRange(0, visibleSlots.size());
+            }
+        }
+        else {
+            visibleSlots.assign((slotCount + 63) / 64, ~0ull);
+        }
+        occludedSlots.assign(visibleSlots.size(), 0);
+        if (occlusionCulling) {
+            occludeSlots(clipFromWorld);
+        }
+
+        instanceVisible.resize(instanceObjects.size());
+        instanceLods.resize(instanceObjects.size());
+        glm::mat4 viewFromWorld = (view ? *view : glm::mat4(1.0f)) * model;
+        float pixelsPerUnit = projection[1][1] * SCR_HEIGHT * 0.5f; // at a distance of 1
+        auto lookupRange = [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                GameObject* obj = instanceObjects[i];
+                if (!obj || !(visibleSlots[obj->slot / 64] >> (obj->slot % 64) & 1)) {
+                    instanceVisible[i] = CULLED;
+                }
+                else if (occludedSlots[obj->slot / 64] >> (obj->slot % 64) & 1) {
+                    instanceVisible[i] = OCCLUDED;
+                }
+                else {
+                    instanceVisible[i] = VISIBLE;
+                    instanceLods[i] = static_cast<uint8_t>(lodSelection ? selectLod(obj, viewFromWorld, pixelsPerUnit) : 0);
+                }
+            }
+        };
+        if (jobSystem) {
+            jobSystem->parallelFor(0, instanceObjects.size(), 4096, lookupRange);
+        }
+        else {
+            lookupRange(0, instanceObjects.size());
+        }
+
+        // Counted first, so each level's instances can be written straight into their own range
+        visibleInstances.clear();
+        stats = RenderStats();
+        stats.vertexBytes = vertexBytes;
+        stats.indexBytes = indexBytes;
+        for (size_t mesh = 0; mesh < groups.size(); ++mesh) {
+            InstanceGroup& group = groups[mesh];
+            GLint cursor[MAX_MESH_LODS] = {};
+            for (GLint i = group.first; i < group.first + group.count; ++i) {
+                if (instanceVisible[i] == VISIBLE) {
+                    cursor[instanceLods[i]]++;
+                }
+                else if (instanceVisible[i] == OCCLUDED) {
+                    stats.occluded++;
+                }
+            }
+            GLint next = static_cast<GLint>(visibleInstances.size());
+            for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+                group.visibleFirst[lod] = next;
+                group.visibleCount[lod] = cursor[lod];
+                next += cursor[lod];
+                cursor[lod] = group.visibleFirst[lod];
+                size_t range = mesh * MAX_MESH_LODS + lod;
+                stats.lodInstances[lod] += group.visibleCount[lod];
+                stats.lodTriangles[lod] += range < counts.size() ? static_cast<size_t>(group.visibleCount[lod]) * (counts[range] / 3) : 0;
+            }
+            visibleInstances.resize(next);
+            for (GLint i = group.first; i < group.first + group.count; ++i) {
+                if (instanceVisible[i] == VISIBLE) {
+                    visibleInstances[cursor[instanceLods[i]]++] = static_cast<uint32_t>(i);
+                }
+            }
+            stats.instances += group.count;
+        }
+        for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+            stats.triangles += stats.lodTriangles[lod];
+        }
+        stats.visible = visibleInstances.size();
+        stats.culled = stats.instances - stats.visible - stats.occluded;
+
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        glBufferData(GL_ARRAY_BUFFER, visibleInstances.size() * sizeof(uint32_t), visibleInstances.data(), GL_STREAM_DRAW);
+    }
+
+    // Coarsest level whose error, scaled up to the object's bounding radius on screen, is within lodErrorPixels
+    // Starts from last frame's level, so an object near a boundary stays put until it's clearly past it
+    uint32_t selectLod(GameObject* obj, const glm::mat4& viewFromWorld, float pixelsPerUnit) const {
+        const Mesh& mesh = meshRegistry.getMesh(obj->renderMesh);
+        uint32_t lod = std::min(obj->renderLod, mesh.lodCount - 1);
+        if (mesh.lodCount > 1) {
+            glm::vec3 min = objectTransforms.boundsMin.get(obj->slot), max = objectTransforms.boundsMax.get(obj->slot);
+            float radius = glm::length(max - min) * 0.5f;
+            float distance = glm::length(glm::vec3(viewFromWorld * glm::vec4((min + max) * 0.5f, 1.0f)));
+            // Inside its own bounds the object is as big as it gets
+            float screenRadius = distance > radius ? radius * pixelsPerUnit / distance : std::numeric_limits<float>::max();
+            while (lod > 0 && mesh.lods[lod].error * screenRadius > lodErrorPixels) {
+                lod--;
+            }
+            while (lod + 1 < mesh.lodCount && mesh.lods[lod + 1].error * screenRadius <= lodErrorPixels * (1.0f - lodHysteresis)) {
+                lod++;
+            }
+        }
+        obj->renderLod = lod;
+        return lod;
+    }
+
+    // Draws the occluders inside the frustum into the occlusion buffer, then marks every other slot in the frustum
+    // whose bounds are hidden behind them in occludedSlots
+    void occludeSlots(const glm::mat4& clipFromWorld) {
+        occlusionBuffer.clear();
+        for (GameObject* occluder : objectManager->getOccluders()) {
+            uint32_t slot = occluder->slot;
+            if (occluder->mesh == NO_MESH || !(visibleSlots[slot / 64] >> (slot % 64) & 1)) {
+                continue;
+            }
+            const Mesh& mesh = meshRegistry.getMesh(occluder->mesh);
+            occlusionBuffer.rasterize(clipFromWorld * objectTransforms.models[slot], mesh.vertices, mesh.indices);
+        }
+        if (occlusionBuffer.getStats().triangles == 0) {
+            return;
+        }
+        occlusionBuffer.buildHierarchy();
+
+        std::size_t slotCount = objectTransforms.size();
+        auto testRange = [&](size_t firstWord, size_t lastWord) {
+            for (size_t word = firstWord; word < lastWord; ++word) {
+                for (uint64_t bits = visibleSlots[word]; bits; bits &= bits - 1) {
+                    uint32_t slot = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+                    if (slot >= slotCount) {
+                        break;
+                    }
+                    if (!objectTransforms.owners[slot]->occluder &&
+                        occlusionBuffer.isOccluded(clipFromWorld, objectTransforms.boundsMin.get(slot), objectTransforms.boundsMax.get(slot))) {
+                        occludedSlots[word] |= 1ull << (slot % 64);
+                    }
+                }
+            }
+        };
+        if (jobSystem) {
+            jobSystem->parallelFor(0, visibleSlots.size(), 16, testRange);
+        }
+        else {
+            testRange(0, visibleSlots.size());
+        }
+    }
+
+    // GL 3.3 has no base instance, so the instance attribute is re-pointed at each mesh's range of the visible list
+    void setInstanceOffset(GLint firstInstance) {
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        size_t base = static_cast<size_t>(firstInstance) * sizeof(uint32_t);
+        glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)base);
+    }
 };
 
 #endif
\ No newline at end of file
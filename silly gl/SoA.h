@@ -0,0 +1,125 @@
+// SoA.h
+#ifndef SOA_H
+#define SOA_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// Allocator that hands out memory aligned to a full AVX register (32 bytes),
+// so the float streams below can be loaded 4 or 8 at a time without unaligned loads
+template <typename T, std::size_t Alignment = 32>
+class AlignedAllocator {
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(std::size_t count) {
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* pointer, std::size_t) {
+		::operator delete(pointer, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// A vec3 stream stored as three separate float arrays (x, y and z)
+// Bulk passes walk one component at a time, straight through memory
+struct SoAVec3 {
+	AlignedVector<float> x, y, z;
+
+	glm::vec3 get(uint32_t i) const {
+		return glm::vec3(x[i], y[i], z[i]);
+	}
+
+	void set(uint32_t i, glm::vec3 value) {
+		x[i] = value.x;
+		y[i] = value.y;
+		z[i] = value.z;
+	}
+
+	void push(glm::vec3 value) {
+		x.push_back(value.x);
+		y.push_back(value.y);
+		z.push_back(value.z);
+	}
+
+	// Moves the last element into i and shrinks by one, keeping the stream dense
+	void swapRemove(uint32_t i) {
+		x[i] = x.back(); x.pop_back();
+		y[i] = y.back(); y.pop_back();
+		z[i] = z.back(); z.pop_back();
+	}
+
+	void reserve(std::size_t count) {
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+	}
+
+	std::size_t size() const {
+		return x.size();
+	}
+};
+
+// Quaternion stream, same layout idea as SoAVec3
+struct SoAQuat {
+	AlignedVector<float> x, y, z, w;
+
+	glm::quat get(uint32_t i) const {
+		return glm::quat(w[i], x[i], y[i], z[i]);
+	}
+
+	void set(uint32_t i, glm::quat value) {
+		x[i] = value.x;
+		y[i] = value.y;
+		z[i] = value.z;
+		w[i] = value.w;
+	}
+
+	void push(glm::quat value) {
+		x.push_back(value.x);
+		y.push_back(value.y);
+		z.push_back(value.z);
+		w.push_back(value.w);
+	}
+
+	void swapRemove(uint32_t i) {
+		x[i] = x.back(); x.pop_back();
+		y[i] = y.back(); y.pop_back();
+		z[i] = z.back(); z.pop_back();
+		w[i] = w.back(); w.pop_back();
+	}
+
+	void reserve(std::size_t count) {
+		x.reserve(count);
+		y.reserve(count);
+		z.reserve(count);
+		w.reserve(count);
+	}
+
+	std::size_t size() const {
+		return x.size();
+	}
+};
+
+#endif // SOA_H
@@ -0,0 +1,413 @@
+// SpatialHash.h
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstdint>
+
+#include <Broadphase.h>
+
+// -------------------------------------------
+// Declaration of SpatialHash class
+// Uniform grid of cubic cells, only cells that hold something exist, keyed by their integer coordinates
+// Each proxy is listed in every cell its AABB touches, which for similarly sized objects is a handful of cells
+// Moving inside the same cells only stores the new bounds, so most frame to frame motion is O(1)
+// A proxy that would cover more than MAX_PROXY_CELLS cells, like a floor far bigger than the cells, is kept in a
+// separate oversized list instead, which pair finding and queries test linearly
+class SpatialHash {
+public:
+	static const uint64_t MAX_PROXY_CELLS = 256;
+
+	// A cell size that isn't positive and finite would make every cell coordinate meaningless, 1 is used instead
+	SpatialHash(float cellSize = 1.0f) : cellSize(isValidCellSize(cellSize) ? cellSize : 1.0f), inverseCellSize(1.0f / this->cellSize) {}
+
+	static bool isValidCellSize(float cellSize) {
+		return cellSize > 0.0f && std::isfinite(cellSize) && std::isfinite(1.0f / cellSize);
+	}
+
+	uint32_t createProxy(GameObject* owner, glm::vec3 min, glm::vec3 max) {
+		uint32_t id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else {
+			id = static_cast<uint32_t>(proxies.size());
+			proxies.emplace_back();
+		}
+		Proxy& proxy = proxies[id];
+		proxy.owner = owner;
+		proxy.min = min;
+		proxy.max = max;
+		proxy.cellMin = toCell(min);
+		proxy.cellMax = toCell(max);
+		proxy.queryStamp = 0;
+		addToCells(id);
+		return id;
+	}
+
+	void destroyProxy(uint32_t id) {
+		removeFromCells(id);
+		proxies[id].owner = nullptr;
+		freeIds.push_back(id);
+	}
+
+	void updateProxy(uint32_t id, glm::vec3 min, glm::vec3 max) {
+		Proxy& proxy = proxies[id];
+		proxy.min = min;
+		proxy.max = max;
+		glm::ivec3 cellMin = toCell(min);
+		glm::ivec3 cellMax = toCell(max);
+		if (cellMin != proxy.cellMin || cellMax != proxy.cellMax) {
+			removeFromCells(id);
+			proxy.cellMin = cellMin;
+			proxy.cellMax = cellMax;
+			addToCells(id);
+		}
+		else if (proxy.oversizedIndex == IN_GRID) {
+			growOccupied(min, max);
+		}
+	}
+
+	// Every overlapping pair, found by testing the proxies that share a cell
+	// A pair sharing several cells is only reported from the cell holding the min corner of their overlap
+	const std::vector<CollisionPair>& update() {
+		pairs.clear();
+		for (const auto& cell : cells) {
+			const std::vector<uint32_t>& members = cell.second;
+			for (size_t i = 0; i < members.size(); ++i) {
+				const Proxy& a = proxies[members[i]];
+				for (size_t j = i + 1; j < members.size(); ++j) {
+					const Proxy& b = proxies[members[j]];
+					if (!overlaps(a.min, a.max, b.min, b.max)) {
+						continue;
+					}
+					if (cellKey(toCell(glm::max(a.min, b.min))) == cell.first) {
+						pairs.emplace_back(a.owner, b.owner);
+					}
+				}
+			}
+		}
+		// Oversized proxies are in no cell, so each is tested against every other live proxy once
+		for (std::size_t i = 0; i < oversized.size(); ++i) {
+			const Proxy& a = proxies[oversized[i]];
+			for (uint32_t id = 0; id < proxies.size(); ++id) {
+				const Proxy& b = proxies[id];
+				bool tested = b.oversizedIndex != IN_GRID && b.oversizedIndex <= i;
+				if (b.owner != nullptr && !tested && overlaps(a.min, a.max, b.min, b.max)) {
+					pairs.emplace_back(a.owner, b.owner);
+				}
+			}
+		}
+		return pairs;
+	}
+
+	const std::vector<CollisionPair>& getPairs() const {
+		return pairs;
+	}
+
+	// Appends every object whose AABB overlaps the region
+	void queryRegion(glm::vec3 min, glm::vec3 max, std::vector<GameObject*>& results) {
+		stamp++;
+		glm::ivec3 cellMin = toCell(min);
+		glm::ivec3 cellMax = toCell(max);
+		forEachCell(cellMin, cellMax, [&](const std::vector<uint32_t>& members) {
+			for (uint32_t id : members) {
+				Proxy& proxy = proxies[id];
+				// The stamp stops an object spanning several cells being reported more than once
+				if (proxy.queryStamp != stamp && overlaps(min, max, proxy.min, proxy.max)) {
+					proxy.queryStamp = stamp;
+					results.push_back(proxy.owner);
+				}
+			}
+		});
+		for (uint32_t id : oversized) {
+			const Proxy& proxy = proxies[id];
+			if (overlaps(min, max, proxy.min, proxy.max)) {
+				results.push_back(proxy.owner);
+			}
+		}
+	}
+
+	// Appends every object whose AABB is within radius of centre
+	void queryRadius(glm::vec3 centre, float radius, std::vector<GameObject*>& results) {
+		stamp++;
+		float radiusSquared = radius * radius;
+		forEachCell(toCell(centre - radius), toCell(centre + radius), [&](const std::vector<uint32_t>& members) {
+			for (uint32_t id : members) {
+				Proxy& proxy = proxies[id];
+				if (proxy.queryStamp == stamp) {
+					continue;
+				}
+				glm::vec3 closest = glm::clamp(centre, proxy.min, proxy.max);
+				glm::vec3 offset = closest - centre;
+				if (glm::dot(offset, offset) <= radiusSquared) {
+					proxy.queryStamp = stamp;
+					results.push_back(proxy.owner);
+				}
+			}
+		});
+		for (uint32_t id : oversized) {
+			const Proxy& proxy = proxies[id];
+			glm::vec3 offset = glm::clamp(centre, proxy.min, proxy.max) - centre;
+			if (glm::dot(offset, offset) <= radiusSquared) {
+				results.push_back(proxy.owner);
+			}
+		}
+	}
+
+	// Calls visit(owner, distance) for objects whose AABB, grown by radius, the ray hits within maxDistance
+	// visit returns the new max distance like DynamicAABBTree::querySweep, so a closest hit search stops at the first cell past it
+	// Cells are walked in ray order (Amanatides-Woo), each along with its neighbours within radius
+	// An object listed in several of those cells is visited once for each, and nothing here is written so rays can run in parallel
+	template <typename Visit>
+	void querySweep(glm::vec3 origin, glm::vec3 direction, float radius, float maxDistance, Visit visit) const {
+		glm::vec3 inverseDirection = 1.0f / direction;
+		// Oversized proxies aren't in the cells being walked, so they are all tried first
+		for (uint32_t id : oversized) {
+			const Proxy& proxy = proxies[id];
+			float entry, exit;
+			if (clipRay(origin, inverseDirection, proxy.min - radius, proxy.max + radius, maxDistance, entry, exit)) {
+				maxDistance = visit(proxy.owner, entry);
+			}
+		}
+		if (cells.empty()) {
+			return;
+		}
+		// Only the stretch of the ray that passes near something in the grid is walked
+		float start, end;
+		if (!clipRay(origin, inverseDirection, occupiedMin - radius, occupiedMax + radius, maxDistance, start, end)) {
+			return;
+		}
+		// forEachCell clamps the neighbourhood, this only keeps cell + reach from overflowing
+		glm::ivec3 reach(static_cast<int>(std::min(std::ceil(radius * inverseCellSize), static_cast<float>(2 * CELL_LIMIT))));
+		glm::ivec3 cell = toCell(origin + direction * start);
+		glm::ivec3 step;
+		glm::vec3 next, delta;
+		for (int axis = 0; axis < 3; ++axis) {
+			if (direction[axis] > 0.0f) {
+				step[axis] = 1;
+				next[axis] = ((cell[axis] + 1) * cellSize - origin[axis]) * inverseDirection[axis];
+				delta[axis] = cellSize * inverseDirection[axis];
+			}
+			else if (direction[axis] < 0.0f) {
+				step[axis] = -1;
+				next[axis] = (cell[axis] * cellSize - origin[axis]) * inverseDirection[axis];
+				delta[axis] = -cellSize * inverseDirection[axis];
+			}
+			else {
+				step[axis] = 0;
+				next[axis] = delta[axis] = std::numeric_limits<float>::infinity();
+			}
+		}
+		while (true) {
+			forEachCell(cell - reach, cell + reach, [&](const std::vector<uint32_t>& members) {
+				for (uint32_t id : members) {
+					const Proxy& proxy = proxies[id];
+					float entry, exit;
+					if (clipRay(origin, inverseDirection, proxy.min - radius, proxy.max + radius, maxDistance, entry, exit)) {
+						maxDistance = visit(proxy.owner, entry);
+					}
+				}
+			});
+			// Whatever a later cell holds is hit no earlier than this cell is left
+			int axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+			if (next[axis] > std::min(maxDistance, end)) {
+				return;
+			}
+			cell[axis] += step[axis];
+			next[axis] += delta[axis];
+		}
+	}
+
+	float getCellSize() const {
+		return cellSize;
+	}
+
+	std::size_t getCellCount() const {
+		return cells.size();
+	}
+
+	std::size_t getOversizedCount() const {
+		return oversized.size();
+	}
+
+	void clear() {
+		cells.clear();
+		oversized.clear();
+		proxies.clear();
+		freeIds.clear();
+		pairs.clear();
+		occupiedMin = glm::vec3(std::numeric_limits<float>::max());
+		occupiedMax = glm::vec3(-std::numeric_limits<float>::max());
+	}
+
+private:
+	static const uint32_t IN_GRID = UINT32_MAX;
+
+	struct Proxy {
+		glm::vec3 min;
+		glm::vec3 max;
+		glm::ivec3 cellMin;
+		glm::ivec3 cellMax;
+		GameObject* owner = nullptr;
+		uint32_t queryStamp = 0;
+		uint32_t oversizedIndex = IN_GRID; // position in oversized, or IN_GRID for a proxy listed in its cells
+	};
+
+	// Mixes the packed cell key, as cell coordinates are small consecutive integers
+	struct CellHash {
+		std::size_t operator()(uint64_t key) const {
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdull;
+			key ^= key >> 33;
+			return static_cast<std::size_t>(key);
+		}
+	};
+
+	float cellSize;
+	float inverseCellSize;
+	std::unordered_map<uint64_t, std::vector<uint32_t>, CellHash> cells;
+	std::vector<Proxy> proxies;
+	std::vector<uint32_t> freeIds;
+	std::vector<uint32_t> oversized; // proxies covering more than MAX_PROXY_CELLS cells
+	std::vector<CollisionPair> pairs;
+	uint32_t stamp = 0;
+	// Bounds of everything ever added to the cells since the last clear, they only grow, which is fine for clipping rays
+	glm::vec3 occupiedMin = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 occupiedMax = glm::vec3(-std::numeric_limits<float>::max());
+
+	static bool overlaps(glm::vec3 minA, glm::vec3 maxA, glm::vec3 minB, glm::vec3 maxB) {
+		return minA.x <= maxB.x && maxA.x >= minB.x &&
+			minA.y <= maxB.y && maxA.y >= minB.y &&
+			minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	void growOccupied(glm::vec3 min, glm::vec3 max) {
+		occupiedMin = glm::min(occupiedMin, min);
+		occupiedMax = glm::max(occupiedMax, max);
+	}
+
+	// Slab test giving the stretch [entry, exit] of the ray within [0, maxDistance] that is inside the box
+	static bool clipRay(glm::vec3 origin, glm::vec3 inverseDirection, glm::vec3 min, glm::vec3 max, float maxDistance, float& entry, float& exit) {
+		glm::vec3 t1 = (min - origin) * inverseDirection;
+		glm::vec3 t2 = (max - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t1, t2);
+		glm::vec3 tFar = glm::max(t1, t2);
+		entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		return entry <= exit;
+	}
+
+	// 21 bits per axis in cellKey, so cells within about a million cells of the origin are unique
+	static const int CELL_LIMIT = 1 << 20;
+
+	// Clamped to the range cellKey can tell apart, so huge or infinite points cannot overflow the conversion
+	glm::ivec3 toCell(glm::vec3 point) const {
+		glm::vec3 scaled = glm::clamp(point * inverseCellSize, glm::vec3(-CELL_LIMIT), glm::vec3(CELL_LIMIT - 1));
+		return glm::ivec3(glm::floor(scaled));
+	}
+
+	static uint64_t cellKey(glm::ivec3 cell) {
+		const uint64_t mask = (1ull << 21) - 1;
+		return ((static_cast<uint64_t>(cell.x) & mask) << 42) |
+			((static_cast<uint64_t>(cell.y) & mask) << 21) |
+			(static_cast<uint64_t>(cell.z) & mask);
+	}
+
+	static glm::ivec3 keyCell(uint64_t key) {
+		// Shifting each 21 bit field to the top of an int and back sign extends it
+		auto field = [key](int shift) {
+			return static_cast<int32_t>(static_cast<uint32_t>(key >> shift) << 11) >> 11;
+		};
+		return glm::ivec3(field(42), field(21), field(0));
+	}
+
+	// Visits the member list of every occupied cell in the range, which is first clamped to the occupied bounds
+	// When the range still holds more cells than exist, walking the existing cells and skipping those outside is cheaper,
+	// so a huge query costs at most one pass over the occupied cells
+	template <typename Visit>
+	void forEachCell(glm::ivec3 cellMin, glm::ivec3 cellMax, Visit visit) const {
+		if (cells.empty()) {
+			return;
+		}
+		cellMin = glm::max(cellMin, toCell(occupiedMin));
+		cellMax = glm::min(cellMax, toCell(occupiedMax));
+		if (cellMin.x > cellMax.x || cellMin.y > cellMax.y || cellMin.z > cellMax.z) {
+			return;
+		}
+		uint64_t rangeCells = static_cast<uint64_t>(cellMax.x - cellMin.x + 1) *
+			static_cast<uint64_t>(cellMax.y - cellMin.y + 1) *
+			static_cast<uint64_t>(cellMax.z - cellMin.z + 1);
+		if (rangeCells > cells.size()) {
+			for (const auto& cell : cells) {
+				glm::ivec3 coordinate = keyCell(cell.first);
+				if (glm::all(glm::greaterThanEqual(coordinate, cellMin)) && glm::all(glm::lessThanEqual(coordinate, cellMax))) {
+					visit(cell.second);
+				}
+			}
+			return;
+		}
+		for (int x = cellMin.x; x <= cellMax.x; ++x) {
+			for (int y = cellMin.y; y <= cellMax.y; ++y) {
+				for (int z = cellMin.z; z <= cellMax.z; ++z) {
+					auto it = cells.find(cellKey(glm::ivec3(x, y, z)));
+					if (it != cells.end()) {
+						visit(it->second);
+					}
+				}
+			}
+		}
+	}
+
+	void addToCells(uint32_t id) {
+		Proxy& proxy = proxies[id];
+		glm::ivec3 span = proxy.cellMax - proxy.cellMin + 1;
+		if (static_cast<uint64_t>(span.x) * static_cast<uint64_t>(span.y) * static_cast<uint64_t>(span.z) > MAX_PROXY_CELLS) {
+			proxy.oversizedIndex = static_cast<uint32_t>(oversized.size());
+			oversized.push_back(id);
+			return;
+		}
+		growOccupied(proxy.min, proxy.max);
+		for (int x = proxy.cellMin.x; x <= proxy.cellMax.x; ++x) {
+			for (int y = proxy.cellMin.y; y <= proxy.cellMax.y; ++y) {
+				for (int z = proxy.cellMin.z; z <= proxy.cellMax.z; ++z) {
+					cells[cellKey(glm::ivec3(x, y, z))].push_back(id);
+				}
+			}
+		}
+	}
+
+	void removeFromCells(uint32_t id) {
+		Proxy& proxy = proxies[id];
+		if (proxy.oversizedIndex != IN_GRID) {
+			oversized[proxy.oversizedIndex] = oversized.back();
+			proxies[oversized.back()].oversizedIndex = proxy.oversizedIndex;
+			oversized.pop_back();
+			proxy.oversizedIndex = IN_GRID;
+			return;
+		}
+		for (int x = proxy.cellMin.x; x <= proxy.cellMax.x; ++x) {
+			for (int y = proxy.cellMin.y; y <= proxy.cellMax.y; ++y) {
+				for (int z = proxy.cellMin.z; z <= proxy.cellMax.z; ++z) {
+					auto it = cells.find(cellKey(glm::ivec3(x, y, z)));
+					std::vector<uint32_t>& members = it->second;
+					*std::find(members.begin(), members.end(), id) = members.back();
+					members.pop_back();
+					if (members.empty()) {
+						cells.erase(it);
+					}
+				}
+			}
+		}
+	}
+};
+
+#endif // SPATIALHASH_H
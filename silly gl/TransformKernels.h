@@ -0,0 +1,333 @@
+// TransformKernels.h
+#ifndef TRANSFORMKERNELS_H
+#define TRANSFORMKERNELS_H
+
+#define GLM_FORCE_SSE42 // or GLM_FORCE_SSE42 if your processor supports it
+#define GLM_FORCE_ALIGNED
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <span>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+#include <SoA.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSFORM_KERNELS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_KERNELS_SSE
+#endif
+
+// One float per slot, used for the leftovers that don't fill a whole register
+struct ScalarLanes {
+	float v;
+	static const std::size_t width = 1;
+
+	static ScalarLanes broadcast(float value) { return { value }; }
+	static ScalarLanes load(const float* stream, const uint32_t* slots, bool) { return { stream[slots[0]] }; }
+	void store(float* stream, const uint32_t* slots, bool) const { stream[slots[0]] = v; }
+	static ScalarLanes loadLanes(const float* lanes) { return { lanes[0] }; }
+	void storeLanes(float* lanes) const { lanes[0] = v; }
+	ScalarLanes sqrt() const { return { std::sqrt(v) }; }
+	ScalarLanes abs() const { return { std::fabs(v) }; }
+	ScalarLanes min(ScalarLanes other) const { return { std::fmin(v, other.v) }; }
+	ScalarLanes max(ScalarLanes other) const { return { std::fmax(v, other.v) }; }
+	// Comparisons give all bits set where true, the same masks the SIMD versions produce
+	static ScalarLanes select(ScalarLanes mask, ScalarLanes ifTrue, ScalarLanes ifFalse) { return std::bit_cast<uint32_t>(mask.v) ? ifTrue : ifFalse; }
+
+	friend ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.v + b.v }; }
+	friend ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.v - b.v }; }
+	friend ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.v * b.v }; }
+	friend ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return { a.v / b.v }; }
+	friend ScalarLanes operator<(ScalarLanes a, ScalarLanes b) { return { std::bit_cast<float>(a.v < b.v ? 0xFFFFFFFFu : 0u) }; }
+	friend ScalarLanes operator&(ScalarLanes a, ScalarLanes b) { return { std::bit_cast<float>(std::bit_cast<uint32_t>(a.v) & std::bit_cast<uint32_t>(b.v)) }; }
+};
+
+// As many slots as fit in one register, 8 with AVX2 and 4 with SSE
+// Contiguous slots are loaded straight from the stream, anything else is gathered lane by lane
+#if defined(TRANSFORM_KERNELS_AVX2)
+struct FloatLanes {
+	__m256 v;
+	static const std::size_t width = 8;
+
+	static FloatLanes broadcast(float value) { return { _mm256_set1_ps(value) }; }
+	static FloatLanes load(const float* stream, const uint32_t* slots, bool contiguous) {
+		if (contiguous) {
+			return { _mm256_loadu_ps(stream + slots[0]) };
+		}
+		return { _mm256_i32gather_ps(stream, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots)), 4) };
+	}
+	void store(float* stream, const uint32_t* slots, bool contiguous) const {
+		if (contiguous) {
+			_mm256_storeu_ps(stream + slots[0], v);
+			return;
+		}
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, v);
+		for (std::size_t i = 0; i < 8; ++i) {
+			stream[slots[i]] = lanes[i];
+		}
+	}
+	static FloatLanes loadLanes(const float* lanes) { return { _mm256_loadu_ps(lanes) }; }
+	void storeLanes(float* lanes) const { _mm256_storeu_ps(lanes, v); }
+	FloatLanes sqrt() const { return { _mm256_sqrt_ps(v) }; }
+	FloatLanes abs() const { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v) }; }
+	FloatLanes min(FloatLanes other) const { return { _mm256_min_ps(v, other.v) }; }
+	FloatLanes max(FloatLanes other) const { return { _mm256_max_ps(v, other.v) }; }
+	static FloatLanes select(FloatLanes mask, FloatLanes ifTrue, FloatLanes ifFalse) { return { _mm256_blendv_ps(ifFalse.v, ifTrue.v, mask.v) }; }
+
+	friend FloatLanes operator+(FloatLanes a, FloatLanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+	friend FloatLanes operator-(FloatLanes a, FloatLanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	friend FloatLanes operator*(FloatLanes a, FloatLanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	friend FloatLanes operator/(FloatLanes a, FloatLanes b) { return { _mm256_div_ps(a.v, b.v) }; }
+	friend FloatLanes operator<(FloatLanes a, FloatLanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	friend FloatLanes operator&(FloatLanes a, FloatLanes b) { return { _mm256_and_ps(a.v, b.v) }; }
+};
+#elif defined(TRANSFORM_KERNELS_SSE)
+struct FloatLanes {
+	__m128 v;
+	static const std::size_t width = 4;
+
+	static FloatLanes broadcast(float value) { return { _mm_set1_ps(value) }; }
+	static FloatLanes load(const float* stream, const uint32_t* slots, bool contiguous) {
+		if (contiguous) {
+			return { _mm_loadu_ps(stream + slots[0]) };
+		}
+		return { _mm_setr_ps(stream[slots[0]], stream[slots[1]], stream[slots[2]], stream[slots[3]]) };
+	}
+	void store(float* stream, const uint32_t* slots, bool contiguous) const {
+		if (contiguous) {
+			_mm_storeu_ps(stream + slots[0], v);
+			return;
+		}
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, v);
+		for (std::size_t i = 0; i < 4; ++i) {
+			stream[slots[i]] = lanes[i];
+		}
+	}
+	static FloatLanes loadLanes(const float* lanes) { return { _mm_loadu_ps(lanes) }; }
+	void storeLanes(float* lanes) const { _mm_storeu_ps(lanes, v); }
+	FloatLanes sqrt() const { return { _mm_sqrt_ps(v) }; }
+	FloatLanes abs() const { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), v) }; }
+	FloatLanes min(FloatLanes other) const { return { _mm_min_ps(v, other.v) }; }
+	FloatLanes max(FloatLanes other) const { return { _mm_max_ps(v, other.v) }; }
+	static FloatLanes select(FloatLanes mask, FloatLanes ifTrue, FloatLanes ifFalse) {
+		return { _mm_or_ps(_mm_and_ps(mask.v, ifTrue.v), _mm_andnot_ps(mask.v, ifFalse.v)) };
+	}
+
+	friend FloatLanes operator+(FloatLanes a, FloatLanes b) { return { _mm_add_ps(a.v, b.v) }; }
+	friend FloatLanes operator-(FloatLanes a, FloatLanes b) { return { _mm_sub_ps(a.v, b.v) }; }
+	friend FloatLanes operator*(FloatLanes a, FloatLanes b) { return { _mm_mul_ps(a.v, b.v) }; }
+	friend FloatLanes operator/(FloatLanes a, FloatLanes b) { return { _mm_div_ps(a.v, b.v) }; }
+	friend FloatLanes operator<(FloatLanes a, FloatLanes b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	friend FloatLanes operator&(FloatLanes a, FloatLanes b) { return { _mm_and_ps(a.v, b.v) }; }
+};
+#else
+typedef ScalarLanes FloatLanes;
+#endif
+
+// Calls kernel.template run<Lanes>(slots, contiguous) over the slots, a register's worth at a time
+template <typename Kernel>
+inline void runTransformKernel(std::span<const uint32_t> slots, const Kernel& kernel) {
+	std::size_t i = 0;
+	for (; i + FloatLanes::width <= slots.size(); i += FloatLanes::width) {
+		const uint32_t* group = slots.data() + i;
+		bool contiguous = true;
+		for (std::size_t lane = 1; lane < FloatLanes::width; ++lane) {
+			contiguous &= group[lane] == group[0] + lane;
+		}
+		kernel.template run<FloatLanes>(group, contiguous);
+	}
+	for (; i < slots.size(); ++i) {
+		kernel.template run<ScalarLanes>(slots.data() + i, true);
+	}
+}
+
+// Adds an offset to every position
+struct TranslateKernel {
+	SoAVec3& positions;
+	glm::vec3 offset;
+
+	template <typename Lanes>
+	void run(const uint32_t* slots, bool contiguous) const {
+		(Lanes::load(positions.x.data(), slots, contiguous) + Lanes::broadcast(offset.x)).store(positions.x.data(), slots, contiguous);
+		(Lanes::load(positions.y.data(), slots, contiguous) + Lanes::broadcast(offset.y)).store(positions.y.data(), slots, contiguous);
+		(Lanes::load(positions.z.data(), slots, contiguous) + Lanes::broadcast(offset.z)).store(positions.z.data(), slots, contiguous);
+	}
+};
+
+// Pre-multiplies every orientation by rotation, and if movePositions is set swings positions around pivot too
+struct RotateKernel {
+	SoAVec3& positions;
+	SoAQuat& rotations;
+	glm::quat rotation;
+	glm::vec3 pivot;
+	bool movePositions;
+
+	template <typename Lanes>
+	void run(const uint32_t* slots, bool contiguous) const {
+		Lanes rw = Lanes::broadcast(rotation.w), rx = Lanes::broadcast(rotation.x);
+		Lanes ry = Lanes::broadcast(rotation.y), rz = Lanes::broadcast(rotation.z);
+		Lanes qw = Lanes::load(rotations.w.data(), slots, contiguous);
+		Lanes qx = Lanes::load(rotations.x.data(), slots, contiguous);
+		Lanes qy = Lanes::load(rotations.y.data(), slots, contiguous);
+		Lanes qz = Lanes::load(rotations.z.data(), slots, contiguous);
+
+		Lanes w = rw * qw - rx * qx - ry * qy - rz * qz;
+		Lanes x = rw * qx + rx * qw + ry * qz - rz * qy;
+		Lanes y = rw * qy - rx * qz + ry * qw + rz * qx;
+		Lanes z = rw * qz + rx * qy - ry * qx + rz * qw;
+
+		// Renormalised every time, so holding a rotation for minutes doesn't let the quaternions drift
+		Lanes inverseLength = Lanes::broadcast(1.0f) / (w * w + x * x + y * y + z * z).sqrt();
+		(w * inverseLength).store(rotations.w.data(), slots, contiguous);
+		(x * inverseLength).store(rotations.x.data(), slots, contiguous);
+		(y * inverseLength).store(rotations.y.data(), slots, contiguous);
+		(z * inverseLength).store(rotations.z.data(), slots, contiguous);
+
+		if (!movePositions) {
+			return;
+		}
+		glm::mat3 matrix = glm::mat3_cast(rotation);
+		Lanes px = Lanes::broadcast(pivot.x), py = Lanes::broadcast(pivot.y), pz = Lanes::broadcast(pivot.z);
+		Lanes dx = Lanes::load(positions.x.data(), slots, contiguous) - px;
+		Lanes dy = Lanes::load(positions.y.data(), slots, contiguous) - py;
+		Lanes dz = Lanes::load(positions.z.data(), slots, contiguous) - pz;
+		(px + Lanes::broadcast(matrix[0][0]) * dx + Lanes::broadcast(matrix[1][0]) * dy + Lanes::broadcast(matrix[2][0]) * dz).store(positions.x.data(), slots, contiguous);
+		(py + Lanes::broadcast(matrix[0][1]) * dx + Lanes::broadcast(matrix[1][1]) * dy + Lanes::broadcast(matrix[2][1]) * dz).store(positions.y.data(), slots, contiguous);
+		(pz + Lanes::broadcast(matrix[0][2]) * dx + Lanes::broadcast(matrix[1][2]) * dy + Lanes::broadcast(matrix[2][2]) * dz).store(positions.z.data(), slots, contiguous);
+	}
+};
+
+// Multiplies every scale, and moves positions away from or towards pivot by the same factor
+struct ScaleKernel {
+	SoAVec3& positions;
+	SoAVec3& scales;
+	glm::vec3 scale;
+	glm::vec3 pivot;
+
+	template <typename Lanes>
+	void run(const uint32_t* slots, bool contiguous) const {
+		Lanes sx = Lanes::broadcast(scale.x), sy = Lanes::broadcast(scale.y), sz = Lanes::broadcast(scale.z);
+		(Lanes::load(scales.x.data(), slots, contiguous) * sx).store(scales.x.data(), slots, contiguous);
+		(Lanes::load(scales.y.data(), slots, contiguous) * sy).store(scales.y.data(), slots, contiguous);
+		(Lanes::load(scales.z.data(), slots, contiguous) * sz).store(scales.z.data(), slots, contiguous);
+		Lanes px = Lanes::broadcast(pivot.x), py = Lanes::broadcast(pivot.y), pz = Lanes::broadcast(pivot.z);
+		(px + (Lanes::load(positions.x.data(), slots, contiguous) - px) * sx).store(positions.x.data(), slots, contiguous);
+		(py + (Lanes::load(positions.y.data(), slots, contiguous) - py) * sy).store(positions.y.data(), slots, contiguous);
+		(pz + (Lanes::load(positions.z.data(), slots, contiguous) - pz) * sz).store(positions.z.data(), slots, contiguous);
+	}
+};
+
+// Builds translate * rotate * scale matrices, the same result as GameObject::getModelMatrix
+struct ModelMatrixKernel {
+	const SoAVec3& positions;
+	const SoAQuat& rotations;
+	const SoAVec3& scales;
+	glm::mat4* models;
+
+	template <typename Lanes>
+	void run(const uint32_t* slots, bool contiguous) const {
+		Lanes x = Lanes::load(rotations.x.data(), slots, contiguous);
+		Lanes y = Lanes::load(rotations.y.data(), slots, contiguous);
+		Lanes z = Lanes::load(rotations.z.data(), slots, contiguous);
+		Lanes w = Lanes::load(rotations.w.data(), slots, contiguous);
+		Lanes sx = Lanes::load(scales.x.data(), slots, contiguous);
+		Lanes sy = Lanes::load(scales.y.data(), slots, contiguous);
+		Lanes sz = Lanes::load(scales.z.data(), slots, contiguous);
+		Lanes one = Lanes::broadcast(1.0f), two = Lanes::broadcast(2.0f);
+
+		Lanes xx = x * x, yy = y * y, zz = z * z;
+		Lanes xy = x * y, xz = x * z, yz = y * z;
+		Lanes wx = w * x, wy = w * y, wz = w * z;
+
+		// Rotation columns scaled by the matching scale axis, lane by lane
+		float columns[9][Lanes::width];
+		((one - two * (yy + zz)) * sx).storeLanes(columns[0]);
+		(two * (xy + wz) * sx).storeLanes(columns[1]);
+		(two * (xz - wy) * sx).storeLanes(columns[2]);
+		(two * (xy - wz) * sy).storeLanes(columns[3]);
+		((one - two * (xx + zz)) * sy).storeLanes(columns[4]);
+		(two * (yz + wx) * sy).storeLanes(columns[5]);
+		(two * (xz + wy) * sz).storeLanes(columns[6]);
+		(two * (yz - wx) * sz).storeLanes(columns[7]);
+		((one - two * (xx + yy)) * sz).storeLanes(columns[8]);
+
+		for (std::size_t lane = 0; lane < Lanes::width; ++lane) {
+			uint32_t slot = slots[lane];
+			glm::mat4& model = models[slot];
+			model[0] = glm::vec4(columns[0][lane], columns[1][lane], columns[2][lane], 0.0f);
+			model[1] = glm::vec4(columns[3][lane], columns[4][lane], columns[5][lane], 0.0f);
+			model[2] = glm::vec4(columns[6][lane], columns[7][lane], columns[8][lane], 0.0f);
+			model[3] = glm::vec4(positions.x[slot], positions.y[slot], positions.z[slot], 1.0f);
+		}
+	}
+};
+
+// World space AABBs straight from position, rotation and scale, the same result as GameObject::updateAABB
+// localBounds(slot, centre, extent) gives each slot's local box as a centre and half size
+template <typename LocalBounds>
+struct BoundsKernel {
+	const SoAVec3& positions;
+	const SoAQuat& rotations;
+	const SoAVec3& scales;
+	SoAVec3& boundsMin;
+	SoAVec3& boundsMax;
+	LocalBounds localBounds;
+
+	template <typename Lanes>
+	void run(const uint32_t* slots, bool contiguous) const {
+		float local[6][Lanes::width];
+		for (std::size_t lane = 0; lane < Lanes::width; ++lane) {
+			glm::vec3 centre, extent;
+			localBounds(slots[lane], centre, extent);
+			local[0][lane] = centre.x;
+			local[1][lane] = centre.y;
+			local[2][lane] = centre.z;
+			local[3][lane] = extent.x;
+			local[4][lane] = extent.y;
+			local[5][lane] = extent.z;
+		}
+		Lanes cx = Lanes::loadLanes(local[0]), cy = Lanes::loadLanes(local[1]), cz = Lanes::loadLanes(local[2]);
+		Lanes ex = Lanes::loadLanes(local[3]), ey = Lanes::loadLanes(local[4]), ez = Lanes::loadLanes(local[5]);
+
+		Lanes x = Lanes::load(rotations.x.data(), slots, contiguous);
+		Lanes y = Lanes::load(rotations.y.data(), slots, contiguous);
+		Lanes z = Lanes::load(rotations.z.data(), slots, contiguous);
+		Lanes w = Lanes::load(rotations.w.data(), slots, contiguous);
+		Lanes sx = Lanes::load(scales.x.data(), slots, contiguous);
+		Lanes sy = Lanes::load(scales.y.data(), slots, contiguous);
+		Lanes sz = Lanes::load(scales.z.data(), slots, contiguous);
+		Lanes one = Lanes::broadcast(1.0f), two = Lanes::broadcast(2.0f);
+
+		Lanes xx = x * x, yy = y * y, zz = z * z;
+		Lanes xy = x * y, xz = x * z, yz = y * z;
+		Lanes wx = w * x, wy = w * y, wz = w * z;
+
+		// Columns of rotation * scale, m[column][row]
+		Lanes m00 = (one - two * (yy + zz)) * sx, m01 = two * (xy + wz) * sx, m02 = two * (xz - wy) * sx;
+		Lanes m10 = two * (xy - wz) * sy, m11 = (one - two * (xx + zz)) * sy, m12 = two * (yz + wx) * sy;
+		Lanes m20 = two * (xz + wy) * sz, m21 = two * (yz - wx) * sz, m22 = (one - two * (xx + yy)) * sz;
+
+		Lanes centreX = Lanes::load(positions.x.data(), slots, contiguous) + m00 * cx + m10 * cy + m20 * cz;
+		Lanes centreY = Lanes::load(positions.y.data(), slots, contiguous) + m01 * cx + m11 * cy + m21 * cz;
+		Lanes centreZ = Lanes::load(positions.z.data(), slots, contiguous) + m02 * cx + m12 * cy + m22 * cz;
+		Lanes extentX = m00.abs() * ex + m10.abs() * ey + m20.abs() * ez;
+		Lanes extentY = m01.abs() * ex + m11.abs() * ey + m21.abs() * ez;
+		Lanes extentZ = m02.abs() * ex + m12.abs() * ey + m22.abs() * ez;
+
+		(centreX - extentX).store(boundsMin.x.data(), slots, contiguous);
+		(centreY - extentY).store(boundsMin.y.data(), slots, contiguous);
+		(centreZ - extentZ).store(boundsMin.z.data(), slots, contiguous);
+		(centreX + extentX).store(boundsMax.x.data(), slots, contiguous);
+		(centreY + extentY).store(boundsMax.y.data(), slots, contiguous);
+		(centreZ + extentZ).store(boundsMax.z.data(), slots, contiguous);
+	}
+};
+
+#endif // TRANSFORMKERNELS_H
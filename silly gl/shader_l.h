@@ -96,6 +96,17 @@ public:
     {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
     }
+    // ------------------------------------------------------------------------
+    // for uniforms set many times a frame, look the location up once with getLocation
+    void setVec3(GLint location, const glm::vec3& value) const
+    {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+    // ------------------------------------------------------------------------
+    GLint getLocation(const std::string& name) const
+    {
+        return glGetUniformLocation(ID, name.c_str());
+    }
 private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
@@ -1,13 +1,22 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec3 aPos; // in the renderer's vertex format, local space once dequantized
+layout (location = 1) in uint aInstance; // per instance, which model matrix to use, vertices are in local space
 
 out vec3 ourColor;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform samplerBuffer instanceMatrices; // every instance's model matrix, one column per texel
+uniform vec3 positionOffset; // per mesh, undoes the vertex format's quantization
+uniform vec3 positionScale;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    ourColor = vec3(aPos.x, aPos.y, aPos.z);
+    int base = int(aInstance) * 4;
+    mat4 aObject = mat4(texelFetch(instanceMatrices, base), texelFetch(instanceMatrices, base + 1),
+        texelFetch(instanceMatrices, base + 2), texelFetch(instanceMatrices, base + 3));
+    vec3 localPos = positionOffset + positionScale * aPos;
+    vec4 worldPos = aObject * vec4(localPos, 1.0);
+    gl_Position = projection * view * model * worldPos;
+    ourColor = vec3(worldPos.x, worldPos.y, worldPos.z);
 }
\ No newline at end of file
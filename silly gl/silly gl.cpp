@@ -25,12 +25,68 @@ const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
 // load globals
+JobSystem jobSystem; // one worker per core besides this thread, pass a count to change it
 Camera globalCamera;
 ObjectManager objectManager;
 InputManager inputManager(&globalCamera, &objectManager);
 ScriptManager scriptManager;
-int main()
+
+// Offline baker, "silly gl --bake model.obj|model.glb out.smesh" imports the model the way the engine would, gives each
+// of its meshes levels of detail and writes them in the baked format (out_1.smesh and so on when there are several)
+int bakeModel(const std::string& input, const std::string& output)
+{
+    // The OBJ importer splits parsing across the job system, the same as in the game
+    objectManager.setJobSystem(&jobSystem);
+    MeshHandle firstNew = static_cast<MeshHandle>(meshRegistry.size());
+    bool glb = input.size() >= 4 && input.compare(input.size() - 4, 4, ".glb") == 0;
+    // Copied rather than left in the mapping, so glTF meshes get optimized like OBJ ones before they're baked
+    ObjectHandle model = glb ? objectManager.addGltf(input, glm::vec3(0.0f), "model", nullptr, false) : objectManager.addObj(input, glm::vec3(0.0f), "model");
+    if (!objectManager.getObject(model))
+    {
+        return -1;
+    }
+    MeshHandle count = static_cast<MeshHandle>(meshRegistry.size()) - firstNew;
+    for (MeshHandle mesh = firstNew; mesh < meshRegistry.size(); ++mesh)
+    {
+        std::string path = output;
+        if (count > 1)
+        {
+            std::size_t extension = path.find_last_of('.');
+            std::string suffix = "_" + std::to_string(mesh - firstNew);
+            path = extension == std::string::npos ? path + suffix : path.substr(0, extension) + suffix + path.substr(extension);
+        }
+        meshRegistry.generateLods(mesh);
+        std::string error;
+        if (!writeBakedMesh(meshRegistry.getMesh(mesh), path, &error))
+        {
+            std::cout << "ERROR::MESH::BAKE_FAILED: " << error << std::endl;
+            return -1;
+        }
+        const Mesh& baked = meshRegistry.getMesh(mesh);
+        std::cout << path << ": " << baked.vertices.size() << " vertices, " << baked.indices.size() / 3 << " triangles, "
+            << baked.lodCount << " levels of detail" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
 {
+    if (argc == 4 && std::string(argv[1]) == "--bake")
+    {
+        return bakeModel(argv[2], argv[3]);
+    }
+    // "silly gl --benchmark-overlap" times the batched AABB overlap kernel against the scalar test and exits
+    if (argc == 2 && std::string(argv[1]) == "--benchmark-overlap")
+    {
+        benchmarkOverlap();
+        return 0;
+    }
+    // "silly gl --check-gltf" loads a generated .glb in each position layout and checks what the loader read
+    if (argc == 2 && std::string(argv[1]) == "--check-gltf")
+    {
+        return checkGltfLoader() ? 0 : -1;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -66,12 +122,22 @@ int main()
     // setup renderer and hook it into input manager (should be moved away to a unity scripting type system later, but for now this is ok)
     Renderer renderer(&objectManager, SCR_WIDTH, SCR_HEIGHT);
     renderer.setCamera(&globalCamera);
+    renderer.setJobSystem(&jobSystem);
+    objectManager.setJobSystem(&jobSystem);
+    // Meshes the scripts register get levels of detail straight away, so distant objects draw fewer triangles
+    meshRegistry.setGenerateLods(true);
 
     scriptManager.registerScript(new ExampleScript());
 
     // Start scripts
     scriptManager.startScripts(&inputManager, &objectManager, &globalCamera, &renderer);
 
+    // Meshes get optimized as the scripts register them
+    MeshOptimizationStats meshStats = objectManager.getMeshOptimizationStats();
+    std::cout << "Meshes: " << meshStats.meshes << ", ACMR " << meshStats.cacheBefore.acmr() << " -> " << meshStats.cacheAfter.acmr()
+        << ", ATVR " << meshStats.cacheBefore.atvr() << " -> " << meshStats.cacheAfter.atvr()
+        << ", " << meshStats.unoptimized << " left unoptimized in mapped files\n";
+
     double deltaTime = 0.0f;
     double lastFrame = 0.0f;
     double lastSecond = glfwGetTime();
@@ -86,7 +152,9 @@ int main()
 		if (currentFrame - lastSecond > 1) {
             // A full second has passed. Return all the frames that have passed between that time.
             lastSecond = currentFrame;
-            std::cout << "FPS: " << frames << "\n";
+            const RenderStats& renderStats = renderer.getStats();
+            std::cout << "FPS: " << frames << ", drawn " << renderStats.visible << " of " << renderStats.instances
+                << " (" << renderStats.culled << " culled, " << renderStats.occluded << " occluded), " << renderStats.triangles << " triangles\n";
             frames = 0;
 		}
         deltaTime = currentFrame - lastFrame;